@@ -2,6 +2,65 @@
 
 #include <calc/calculator.h>
 #include <calc/calculatorexception.h>
+#include <calc/formulagraph.h>
+#include <calc/incrementalevaluator.h>
+#include <calc/jit.h>
+#include <calc/programlibrary.h>
+#include <calc/staticexpression.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+	std::atomic<int64_t> allocations{0};
+
+	// Adds the average number of heap allocations per excecution to the benchmark output.
+	class AllocationCounter {
+	public:
+		explicit AllocationCounter(benchmark::State& state, int excecutionsPerIteration)
+			: state_{state}
+			, excecutionsPerIteration_{excecutionsPerIteration}
+			, start_{allocations.load()} {
+		}
+
+		~AllocationCounter() {
+			const auto excecutions = static_cast<double>(state_.iterations()) * excecutionsPerIteration_;
+			state_.counters["allocations"] = excecutions > 0 ? (allocations.load() - start_) / excecutions : 0.0;
+		}
+
+	private:
+		benchmark::State& state_;
+		int excecutionsPerIteration_;
+		int64_t start_;
+	};
+
+}
+
+void* operator new(std::size_t size) {
+	++allocations;
+	if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
 
 class MyFixture : public benchmark::Fixture {
 public:
@@ -20,17 +79,25 @@ public:
 };
 
 
-BENCHMARK_F(MyFixture, noPreCalculation)(benchmark::State& state) {
+// Without (0) and with (1) the expression cache, i.e. the hit path of the cache.
+BENCHMARK_DEFINE_F(MyFixture, noPreCalculation)(benchmark::State& state) {
+	calculator.setExpressionCacheCapacity(state.range(0) == 0 ? 0 : 16);
+	AllocationCounter allocationCounter{state, Iterations};
 	for (auto _ : state) {
 		for (int i = 0; i < Iterations; ++i) {
 			calculator.updateVariable("VAR", i * 0.0001f);
 			calculator.excecute(Expression);
 		}
 	}
+	const auto statistics = calculator.getExpressionCacheStatistics();
+	state.counters["hits"] = static_cast<double>(statistics.hits);
+	state.counters["misses"] = static_cast<double>(statistics.misses);
 }
+BENCHMARK_REGISTER_F(MyFixture, noPreCalculation)->Arg(0)->Arg(1);
 
 BENCHMARK_F(MyFixture, preCalculation)(benchmark::State& state) {
 	calc::Cache cache = calculator.preCalculate(Expression);
+	AllocationCounter allocationCounter{state, Iterations};
 	for (auto _ : state) {
 		for (int i = 0; i < Iterations; ++i) {
 			calculator.updateVariable("VAR", i * 0.0001f);
@@ -39,6 +106,75 @@ BENCHMARK_F(MyFixture, preCalculation)(benchmark::State& state) {
 	}
 }
 
+BENCHMARK_F(MyFixture, preCalculationVariableHandle)(benchmark::State& state) {
+	calc::Cache cache = calculator.preCalculate(Expression);
+	const auto var = calculator.getVariableHandle("VAR");
+	AllocationCounter allocationCounter{state, Iterations};
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.updateVariable(var, i * 0.0001f);
+			calculator.excecute(cache);
+		}
+	}
+}
+
+// Updates 32 inputs each tick, by name (0), by handle (1) or all at once (2).
+BENCHMARK_DEFINE_F(MyFixture, updateManyVariables)(benchmark::State& state) {
+	constexpr int Inputs = 32;
+	std::vector<std::string> names;
+	std::vector<calc::VariableHandle> handles;
+	for (int i = 0; i < Inputs; ++i) {
+		names.push_back("input" + std::to_string(i));
+		handles.push_back(calculator.addVariable(names.back(), 0.f));
+	}
+	std::vector<float> values(calculator.getVariables().size(), 0.f);
+	const auto mode = state.range(0);
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			const float value = i * 0.0001f;
+			if (mode == 0) {
+				for (const auto& name : names) {
+					calculator.updateVariable(name, value);
+				}
+			} else if (mode == 1) {
+				for (auto handle : handles) {
+					calculator.updateVariable(handle, value);
+				}
+			} else {
+				std::fill(values.begin(), values.end(), value);
+				calculator.setVariables(values);
+			}
+			benchmark::ClobberMemory();
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations * Inputs);
+	state.SetLabel(mode == 0 ? "Name" : (mode == 1 ? "Handle" : "setVariables"));
+}
+BENCHMARK_REGISTER_F(MyFixture, updateManyVariables)->Arg(0)->Arg(1)->Arg(2);
+
+// One calculator shared by all threads, each thread excecutes with its own variable context.
+static void excecuteSharedCalculator(benchmark::State& state) {
+	static const auto shared = []() {
+		calc::Calculator calculator;
+		const auto handle = calculator.addVariable("VAR", 3.14f);
+		auto cache = calculator.preCalculate("2.1+-3.2*5^(3-1)/(2*3.14 - 1) + VAR * VAR - VAR / 2");
+		return std::make_tuple(std::move(calculator), std::move(cache), handle);
+	}();
+	const auto& [calculator, cache, handle] = shared;
+
+	auto context = calculator.createVariableContext();
+	constexpr int Iterations = 1000;
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			context.updateVariable(handle, i * 0.0001f);
+			benchmark::DoNotOptimize(calculator.excecute(cache, context));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+}
+BENCHMARK(excecuteSharedCalculator)->ThreadRange(1, 8)->UseRealTime();
+
 BENCHMARK_F(MyFixture, excecutePreCalculatedLongExpression)(benchmark::State& state) {
 	std::string expression = "-1 * (11.2 * 12 / 123 * 10.4^2) * (11.2 * 12 / 123 * 10.4^2)*(11.2 * 12 / 123 * 10.4^2) * (11.2 * 12 / 123 * 10.4^2) - 12";
 	calc::Cache cache = calculator.preCalculate(expression);
@@ -49,3 +185,580 @@ BENCHMARK_F(MyFixture, excecutePreCalculatedLongExpression)(benchmark::State& st
 		}
 	}
 }
+
+BENCHMARK_F(MyFixture, excecutePreCalculatedNestedExpression)(benchmark::State& state) {
+	// Right nested expression, i.e. "VAR^(VAR^(VAR^(...)))", where each argument is far from its operator in postfix notation.
+	std::string expression;
+	for (int i = 0; i < 100; ++i) {
+		expression += "VAR^(";
+	}
+	expression += "1" + std::string(100, ')');
+	calc::Cache cache = calculator.preCalculate(expression);
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			benchmark::DoNotOptimize(calculator.excecute(cache));
+		}
+	}
+}
+
+BENCHMARK_F(MyFixture, preCalculationProvidedStack)(benchmark::State& state) {
+	calc::Cache cache = calculator.preCalculate(Expression);
+	std::vector<float> stack(cache.getStackSize());
+	AllocationCounter allocationCounter{state, Iterations};
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.updateVariable("VAR", i * 0.0001f);
+			benchmark::DoNotOptimize(calculator.excecute(cache, stack));
+		}
+	}
+}
+
+BENCHMARK_F(MyFixture, batchExcecution)(benchmark::State& state) {
+	calc::Cache cache = calculator.preCalculate(Expression);
+	std::vector<float> values(Iterations);
+	for (int i = 0; i < Iterations; ++i) {
+		values[i] = i * 0.0001f;
+	}
+	const std::vector<calc::VariableColumn> columns{{"VAR", values}};
+	std::vector<float> results(Iterations);
+
+	for (auto _ : state) {
+		calculator.excecute(cache, columns, results);
+		benchmark::DoNotOptimize(results.data());
+	}
+}
+
+BENCHMARK_DEFINE_F(MyFixture, batchExcecutionInstructionSet)(benchmark::State& state) {
+	const auto instructionSet = static_cast<calc::InstructionSet>(state.range(0));
+	if (!calc::isSupported(instructionSet)) {
+		state.SkipWithError("Instruction set not supported");
+		return;
+	}
+	calculator.setInstructionSet(instructionSet);
+	calc::Cache cache = calculator.preCalculate("VAR * 2.5 + (VAR - 1) / (VAR + 3) - VAR^1.5");
+	constexpr int Rows = 1 << 16;
+	std::vector<float> values(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		values[i] = 1.f + i * 0.0001f;
+	}
+	const std::vector<calc::VariableColumn> columns{{"VAR", values}};
+	std::vector<float> results(Rows);
+
+	for (auto _ : state) {
+		calculator.excecute(cache, columns, results);
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * Rows);
+	state.SetLabel(instructionSet == calc::InstructionSet::Scalar ? "Scalar" : instructionSet == calc::InstructionSet::Sse2 ? "SSE2" : "AVX2");
+}
+BENCHMARK_REGISTER_F(MyFixture, batchExcecutionInstructionSet)
+	->Arg(static_cast<int>(calc::InstructionSet::Scalar))
+	->Arg(static_cast<int>(calc::InstructionSet::Sse2))
+	->Arg(static_cast<int>(calc::InstructionSet::Avx2));
+
+// Parallel batch excecution of 8 caches over the same 1M rows, using 1, 2, 4 and N threads.
+BENCHMARK_DEFINE_F(MyFixture, parallelBatchExcecution)(benchmark::State& state) {
+	constexpr int Rows = 1 << 20;
+	calculator.addVariable("x", 0.f);
+	std::vector<calc::Cache> caches;
+	for (int i = 0; i < 8; ++i) {
+		caches.push_back(calculator.preCalculate("x * x * " + std::to_string(i) + " - 2.5 * x + VAR / (1 + x * x)"));
+	}
+	std::vector<float> x(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		x[i] = i * 0.0001f;
+	}
+	const std::vector<calc::VariableColumn> columns{{"x", x}};
+	std::vector<std::vector<float>> values(caches.size(), std::vector<float>(Rows));
+	const std::vector<std::span<float>> results(values.begin(), values.end());
+	calc::ThreadPool pool{static_cast<int>(state.range(0))};
+
+	for (auto _ : state) {
+		calculator.excecute(pool, caches, columns, results);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * Rows * caches.size());
+	state.counters["threads"] = pool.getThreads();
+}
+BENCHMARK_REGISTER_F(MyFixture, parallelBatchExcecution)
+	->Arg(1)->Arg(2)->Arg(4)->Arg(std::max(1u, std::thread::hardware_concurrency()))->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Scalar and batch excecution for each value type.
+template <class T>
+static void excecuteValueType(benchmark::State& state) {
+	calc::BasicCalculator<T> calculator;
+	const auto handle = calculator.addVariable("VAR", T{3.14f});
+	const auto cache = calculator.preCalculate("2.1+-3.2*5^(3-1)/(2*3.14 - 1) + VAR * VAR - VAR / 2");
+	constexpr int Iterations = 1000;
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.updateVariable(handle, static_cast<T>(i * 0.0001));
+			benchmark::DoNotOptimize(calculator.excecute(cache));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+}
+BENCHMARK_TEMPLATE(excecuteValueType, float);
+BENCHMARK_TEMPLATE(excecuteValueType, double);
+
+template <class T>
+static void batchExcecutionValueType(benchmark::State& state) {
+	constexpr int Rows = 1 << 16;
+	calc::BasicCalculator<T> calculator;
+	calculator.addVariable("VAR", T{3.14f});
+	const auto cache = calculator.preCalculate("2.1+-3.2*5^(3-1)/(2*3.14 - 1) + VAR * VAR - VAR / 2");
+	std::vector<T> values(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		values[i] = static_cast<T>(i * 0.0001);
+	}
+	const std::vector<calc::BasicVariableColumn<T>> columns{{"VAR", values}};
+	std::vector<T> results(Rows);
+
+	for (auto _ : state) {
+		calculator.excecute(cache, columns, results);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * Rows);
+}
+BENCHMARK_TEMPLATE(batchExcecutionValueType, float);
+BENCHMARK_TEMPLATE(batchExcecutionValueType, double);
+
+BENCHMARK_F(MyFixture, excecuteOptimizedLongExpression)(benchmark::State& state) {
+	std::string expression = "-1 * (11.2 * 12 / 123 * 10.4^2) * (11.2 * 12 / 123 * 10.4^2)*(11.2 * 12 / 123 * 10.4^2) * (11.2 * 12 / 123 * 10.4^2) - 12";
+	calc::Cache cache = calculator.preCalculate(expression, calc::Optimization{});
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			benchmark::DoNotOptimize(calculator.excecute(cache));
+		}
+	}
+	state.counters["size"] = cache.getSize();
+	state.counters["unoptimizedSize"] = calculator.preCalculate(expression).getSize();
+}
+
+BENCHMARK_DEFINE_F(MyFixture, excecuteRepetitiveExpression)(benchmark::State& state) {
+	calculator.addVariable("a", 1.5f);
+	calculator.addVariable("b", 2.5f);
+	calculator.addVariable("c", 3.5f);
+	const std::string expression = "(a*b/c)^2 * (a*b/c)^2 + (a*b/c)^2 / (a*b/c + 1) - (a*b/c + 1)^VAR";
+	const calc::Optimization optimization{.eliminateCommonSubexpressions = state.range(0) != 0};
+	calc::Cache cache = calculator.preCalculate(expression, optimization);
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			benchmark::DoNotOptimize(calculator.excecute(cache));
+		}
+	}
+	state.counters["size"] = cache.getSize();
+	state.SetLabel(optimization.eliminateCommonSubexpressions ? "CSE" : "No CSE");
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteRepetitiveExpression)->Arg(0)->Arg(1);
+
+BENCHMARK_F(MyFixture, parseExpression)(benchmark::State& state) {
+	calculator.addVariable("velocity", 2.5f);
+	calculator.addFunction("clamp", [](float a, float b) {
+		return a < -b ? -b : (a > b ? b : a);
+	});
+	const std::string expression = "clamp(velocity * 12.75 - VAR / 3.5e2, 100) + -(VAR + 0.125)^2 * (1.5 - velocity) / (2 * 3.14159 - 1)";
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			benchmark::DoNotOptimize(calculator.preCalculate(expression));
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * Iterations * expression.size());
+}
+
+BENCHMARK_DEFINE_F(MyFixture, compileReusedContext)(benchmark::State& state) {
+	const bool optimize = state.range(0) != 0;
+	const calc::Optimization optimization{.foldConstants = optimize, .eliminateCommonSubexpressions = optimize};
+	const std::string expression = "(VAR + 1) * (VAR + 1) - 2 * 3 + (VAR / 4) ^ 2 - (VAR + 1) / (1 + 2 * 3.5)";
+
+	calc::CompileContext context;
+	calc::Cache cache;
+	calculator.preCalculate(expression, optimization, context, cache);
+
+	AllocationCounter allocationCounter{state, Iterations};
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.preCalculate(expression, optimization, context, cache);
+			benchmark::DoNotOptimize(cache);
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * Iterations * expression.size());
+	state.SetLabel(optimize ? "Optimized" : "Not optimized");
+}
+BENCHMARK_REGISTER_F(MyFixture, compileReusedContext)->Arg(0)->Arg(1);
+
+namespace {
+
+	// Adds variables named variable0, variable1, ... and returns an expression summing 16 of them.
+	std::string addVariables(calc::Calculator& calculator, int count) {
+		std::string expression;
+		for (int i = 0; i < count; ++i) {
+			calculator.addVariable("variable" + std::to_string(i), static_cast<float>(i));
+		}
+		for (int i = 0; i < 16; ++i) {
+			expression += (i == 0 ? "" : " + ") + ("variable" + std::to_string(i * count / 16));
+		}
+		return expression;
+	}
+
+}
+
+BENCHMARK_DEFINE_F(MyFixture, compileWithManySymbols)(benchmark::State& state) {
+	const std::string expression = addVariables(calculator, static_cast<int>(state.range(0)));
+	calc::CompileContext context;
+	calc::Cache cache;
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.preCalculate(expression, context, cache);
+			benchmark::DoNotOptimize(cache);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations * 16);
+}
+BENCHMARK_REGISTER_F(MyFixture, compileWithManySymbols)->Arg(8)->Arg(128)->Arg(10000);
+
+BENCHMARK_F(MyFixture, excecuteWithManyVariables)(benchmark::State& state) {
+	constexpr int Variables = 10000;
+	std::string expression;
+	std::vector<calc::VariableHandle> handles;
+	for (int i = 0; i < Variables; ++i) {
+		handles.push_back(calculator.addVariable("variable" + std::to_string(i), 1.f));
+		expression += i == 0 ? "variable0" : " + variable" + std::to_string(i);
+	}
+	const auto cache = calculator.preCalculate(expression);
+
+	for (auto _ : state) {
+		calculator.updateVariable(handles[state.iterations() % Variables], 2.f);
+		benchmark::DoNotOptimize(calculator.excecute(cache));
+	}
+	state.SetItemsProcessed(state.iterations() * Variables);
+}
+
+BENCHMARK_DEFINE_F(MyFixture, updateVariableWithManySymbols)(benchmark::State& state) {
+	const int count = static_cast<int>(state.range(0));
+	addVariables(calculator, count);
+	std::vector<std::string> names;
+	for (int i = 0; i < count; ++i) {
+		names.push_back("variable" + std::to_string(i));
+	}
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			calculator.updateVariable(names[i % count], i * 0.0001f);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+}
+BENCHMARK_REGISTER_F(MyFixture, updateVariableWithManySymbols)->Arg(8)->Arg(128)->Arg(10000);
+
+// Excecutes the expression (0) or a long expression calling a registered function (1), interpreted (0) or as native code (1).
+BENCHMARK_DEFINE_F(MyFixture, excecuteJit)(benchmark::State& state) {
+	calculator.addVariable("X", 0.5f);
+	calculator.addFunction("square", [](float value) {
+		return value * value;
+	});
+	const std::string expression = state.range(0) == 0 ? Expression
+		: "square(VAR - X) * 3 + VAR / (X + 2) - (VAR * X - 1) * (VAR + X) / square(X + 1) + VAR^2 - X^3";
+	const calc::Cache cache = calculator.preCalculate(expression);
+	const calc::JitFunction function{calculator, cache};
+	std::vector<float> variables{3.14f, 0.5f};
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			variables[0] = i * 0.0001f;
+			if (state.range(1) == 0) {
+				calculator.setVariables(variables);
+				benchmark::DoNotOptimize(calculator.excecute(cache));
+			} else {
+				benchmark::DoNotOptimize(function(variables.data()));
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteJit)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+// The fixture expression parsed at runtime (0) or during compilation (1).
+BENCHMARK_DEFINE_F(MyFixture, excecuteStaticExpression)(benchmark::State& state) {
+	const calc::Cache cache = calculator.preCalculate(Expression);
+	const calc::StaticExpression<"2.1+-3.2*5^(3-1)/(2*3.14 - 1) + VAR", "VAR"> expression;
+	const auto var = calculator.getVariableHandle("VAR");
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			const float value = i * 0.0001f;
+			benchmark::DoNotOptimize(value);
+			if (state.range(0) == 0) {
+				calculator.updateVariable(var, value);
+				benchmark::DoNotOptimize(calculator.excecute(cache));
+			} else {
+				benchmark::DoNotOptimize(expression(value));
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteStaticExpression)->Arg(0)->Arg(1);
+
+namespace {
+
+	// Adds 100 variables and returns count formulas using them.
+	std::vector<std::string> createFormulas(calc::Calculator& calculator, int count) {
+		for (int i = 0; i < 100; ++i) {
+			calculator.addVariable("v" + std::to_string(i), static_cast<float>(i));
+		}
+		std::vector<std::string> formulas;
+		for (int i = 0; i < count; ++i) {
+			auto v = [&](int n) {
+				return "v" + std::to_string((i * n + 7) % 100);
+			};
+			formulas.push_back(v(1) + " * 1.5 + " + v(3) + " / (" + v(7) + " - 2.5)^2 - " + std::to_string(i) + " * " + v(11));
+		}
+		return formulas;
+	}
+
+}
+
+// Startup with count formulas compiled from text (0) or loaded from a memory mapped program library (1).
+BENCHMARK_DEFINE_F(MyFixture, startupProgramLibrary)(benchmark::State& state) {
+	const auto formulas = createFormulas(calculator, static_cast<int>(state.range(0)));
+	const auto path = "startupProgramLibrary.bin";
+	if (state.range(1) == 1) {
+		std::vector<calc::Cache> caches;
+		for (const auto& formula : formulas) {
+			caches.push_back(calculator.preCalculate(formula));
+		}
+		calc::ProgramLibrary::save(path, calculator, caches);
+	}
+
+	for (auto _ : state) {
+		if (state.range(1) == 0) {
+			calc::CompileContext context;
+			std::vector<calc::Cache> caches(formulas.size());
+			for (size_t i = 0; i < formulas.size(); ++i) {
+				calculator.preCalculate(formulas[i], context, caches[i]);
+			}
+			benchmark::DoNotOptimize(calculator.excecute(caches.back()));
+		} else {
+			const calc::ProgramLibrary library{calculator, path};
+			benchmark::DoNotOptimize(calculator.excecute(library[library.size() - 1]));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	if (state.range(1) == 1) {
+		std::remove(path);
+	}
+}
+BENCHMARK_REGISTER_F(MyFixture, startupProgramLibrary)
+	->Args({10000, 0})->Args({10000, 1})->Args({200000, 0})->Args({200000, 1})->Unit(benchmark::kMillisecond);
+
+// 10k small rules excecuted one cache at a time (0) or packed in a cache set (1).
+BENCHMARK_DEFINE_F(MyFixture, excecuteManyRules)(benchmark::State& state) {
+	constexpr int Rules = 10000;
+	const auto formulas = createFormulas(calculator, Rules);
+	std::vector<calc::Cache> caches;
+	for (const auto& formula : formulas) {
+		caches.push_back(calculator.preCalculate(formula));
+	}
+	// Rules compiled at different times are spread over the heap.
+	std::shuffle(caches.begin(), caches.end(), std::mt19937{1});
+	const calc::CacheSet cacheSet{caches};
+	std::vector<float> results(Rules);
+
+	for (auto _ : state) {
+		if (state.range(0) == 0) {
+			for (int i = 0; i < Rules; ++i) {
+				results[i] = calculator.excecute(caches[i]);
+			}
+		} else {
+			calculator.excecute(cacheSet, results);
+		}
+		benchmark::DoNotOptimize(results.data());
+	}
+	state.SetItemsProcessed(state.iterations() * Rules);
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteManyRules)->Arg(0)->Arg(1);
+
+// A short (0) and a long (1) expression excecuted from the postfix expression (0) or the bytecode (1).
+BENCHMARK_DEFINE_F(MyFixture, excecuteBytecode)(benchmark::State& state) {
+	calculator.addVariable("X", 0.5f);
+	std::string expression = "VAR * 1.5 + X";
+	if (state.range(0) == 1) {
+		expression = "(VAR - 1) * (X + 2) / (VAR * X - 3)";
+		for (int i = 0; i < 8; ++i) {
+			expression += " + (VAR - " + std::to_string(i) + ") * X - VAR / (X + " + std::to_string(i) + ")";
+		}
+	}
+	const calc::Cache cache = calculator.preCalculate(expression);
+	const calc::CacheView view{cache};
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			if (state.range(1) == 0) {
+				benchmark::DoNotOptimize(calculator.excecute(view));
+			} else {
+				benchmark::DoNotOptimize(calculator.excecute(cache));
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+	state.counters["symbols"] = cache.getSize();
+	state.counters["instructions"] = cache.getCodeSize();
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteBytecode)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+// Sum of 16 variables as a chain of binary function calls (0) or one call of a variadic function (1).
+BENCHMARK_DEFINE_F(MyFixture, excecuteNaryFunction)(benchmark::State& state) {
+	constexpr int Arguments = 16;
+	calculator.addFunction("add", [](float a, float b) {
+		return a + b;
+	});
+	calculator.addFunction("sum", [](std::span<const float> values) {
+		float sum = 0;
+		for (float value : values) {
+			sum += value;
+		}
+		return sum;
+	});
+	std::string expression = state.range(0) == 0 ? "v0" : "sum(v0";
+	for (int i = 0; i < Arguments; ++i) {
+		calculator.addVariable("v" + std::to_string(i), static_cast<float>(i));
+		if (i > 0) {
+			expression = state.range(0) == 0 ? "add(" + expression + ", v" + std::to_string(i) + ")" : expression + ", v" + std::to_string(i);
+		}
+	}
+	if (state.range(0) == 1) {
+		expression += ")";
+	}
+	const calc::Cache cache = calculator.preCalculate(expression);
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			benchmark::DoNotOptimize(calculator.excecute(cache));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+	state.counters["instructions"] = cache.getCodeSize();
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteNaryFunction)->Arg(0)->Arg(1);
+
+// Reduction sum (0), avg (1) or dot (2) of arrays with 1M elements, bound without copying.
+BENCHMARK_DEFINE_F(MyFixture, excecuteArrayReduction)(benchmark::State& state) {
+	const auto instructionSet = static_cast<calc::InstructionSet>(state.range(1));
+	if (!calc::isSupported(instructionSet)) {
+		state.SkipWithError("Instruction set not supported");
+		return;
+	}
+	calculator.setInstructionSet(instructionSet);
+	constexpr int Size = 1 << 20;
+	std::vector<float> prices(Size);
+	std::vector<float> weights(Size);
+	for (int i = 0; i < Size; ++i) {
+		prices[i] = 1.f + (i % 100) * 0.01f;
+		weights[i] = 1.f / (1 + i % 7);
+	}
+	calculator.addArray("prices", prices);
+	calculator.addArray("weights", weights);
+	const calc::Cache cache = calculator.preCalculate(state.range(0) == 0 ? "sum(prices)" : state.range(0) == 1 ? "avg(prices)" : "dot(prices, weights)");
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(calculator.excecute(cache));
+	}
+	state.SetItemsProcessed(state.iterations() * Size);
+	state.SetLabel(instructionSet == calc::InstructionSet::Scalar ? "Scalar" : instructionSet == calc::InstructionSet::Sse2 ? "SSE2" : "AVX2");
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteArrayReduction)
+	->ArgsProduct({{0, 1, 2}, {static_cast<int>(calc::InstructionSet::Scalar), static_cast<int>(calc::InstructionSet::Sse2),
+		static_cast<int>(calc::InstructionSet::Avx2)}});
+
+// Balanced sum of a term for each of 64 variables, excecuted after updating 1, 4, 16 or all variables.
+// Excecuted by the calculator (0) or the incremental evaluator (1), which only recalculates the changed paths.
+BENCHMARK_DEFINE_F(MyFixture, excecuteIncremental)(benchmark::State& state) {
+	constexpr int Variables = 64;
+	const int changed = static_cast<int>(state.range(0));
+	std::vector<calc::VariableHandle> handles;
+	std::vector<std::string> terms;
+	for (int i = 0; i < Variables; ++i) {
+		const std::string name = "v" + std::to_string(i);
+		handles.push_back(calculator.addVariable(name, 1.f + i));
+		terms.push_back("(" + name + " * 1.5 + " + name + " ^ 2) / (" + name + " + 3)");
+	}
+	while (terms.size() > 1) {
+		std::vector<std::string> sums;
+		for (size_t i = 0; i < terms.size(); i += 2) {
+			sums.push_back("(" + terms[i] + " + " + terms[i + 1] + ")");
+		}
+		terms = std::move(sums);
+	}
+	const calc::Cache cache = calculator.preCalculate(terms.front());
+	calc::IncrementalEvaluator evaluator{calculator, cache};
+	float value = 0;
+
+	for (auto _ : state) {
+		for (int i = 0; i < Iterations; ++i) {
+			value += 0.001f;
+			for (int j = 0; j < changed; ++j) {
+				if (state.range(1) == 0) {
+					calculator.updateVariable(handles[(i + j) % Variables], value);
+				} else {
+					evaluator.updateVariable(handles[(i + j) % Variables], value);
+				}
+			}
+			benchmark::DoNotOptimize(state.range(1) == 0 ? calculator.excecute(cache) : evaluator.excecute());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * Iterations);
+	state.counters["recalculated"] = state.range(1) == 0 ? evaluator.getSize() : evaluator.getRecalculated();
+}
+BENCHMARK_REGISTER_F(MyFixture, excecuteIncremental)->ArgsProduct({{1, 4, 16, 64}, {0, 1}});
+
+// Graph of 100k formulas in 100 layers of 1000, each formula using two formulas of the previous layer.
+// Recalculated after updating 1, 10 or all 1000 inputs, without (0) and with (1) a thread pool.
+BENCHMARK_DEFINE_F(MyFixture, recalculateFormulaGraph)(benchmark::State& state) {
+	constexpr int Width = 1000;
+	constexpr int Depth = 100;
+	const int changed = static_cast<int>(state.range(0));
+	calc::FormulaGraph graph{calculator};
+	std::vector<calc::VariableHandle> inputs;
+	for (int i = 0; i < Width; ++i) {
+		inputs.push_back(calculator.addVariable("in" + std::to_string(i), static_cast<float>(i % 10)));
+	}
+	for (int depth = 0; depth < Depth; ++depth) {
+		const std::string previous = "f" + std::to_string(depth - 1) + "_";
+		for (int i = 0; i < Width; ++i) {
+			const std::string name = "f" + std::to_string(depth) + "_" + std::to_string(i);
+			if (depth == 0) {
+				graph.addFormula(name, "in" + std::to_string(i) + " * 2 + 1");
+			} else {
+				graph.addFormula(name, previous + std::to_string(i) + " * 0.5 + " + previous + std::to_string((i + 1) % Width) + " * 0.25");
+			}
+		}
+	}
+	calc::ThreadPool pool;
+	graph.recalculate();
+	float value = 0;
+	int64_t recalculated = 0;
+
+	for (auto _ : state) {
+		value += 1;
+		for (int i = 0; i < changed; ++i) {
+			graph.updateVariable(inputs[(static_cast<int>(value) * 7 + i) % Width], value);
+		}
+		if (state.range(1) == 0) {
+			graph.recalculate();
+		} else {
+			graph.recalculate(pool);
+		}
+		recalculated += graph.getRecalculated();
+	}
+	state.SetItemsProcessed(recalculated);
+	state.counters["formulas"] = graph.size();
+	state.counters["recalculated"] = state.iterations() > 0 ? static_cast<double>(recalculated) / state.iterations() : 0.0;
+}
+BENCHMARK_REGISTER_F(MyFixture, recalculateFormulaGraph)->ArgsProduct({{1, 10, 1000}, {0, 1}})->UseRealTime()->Unit(benchmark::kMicrosecond);
@@ -1,9 +1,21 @@
 #include <calc/calculator.h>
 #include <calc/calculatorexception.h>
+#include <calc/formulagraph.h>
+#include <calc/incrementalevaluator.h>
+#include <calc/jit.h>
+#include <calc/programlibrary.h>
+#include <calc/staticexpression.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <thread>
 
 constexpr float ErrorPrecision = 0.001f;
 
@@ -386,4 +398,1189 @@ TEST_F(CalculatorTest, testMoveConstuctor) {
 	ASSERT_EQ(variables.size(), move.getVariables().size());
 	ASSERT_EQ(operators.size(), move.getOperators().size());
 	ASSERT_EQ(functions.size(), move.getFunctions().size());
-}
\ No newline at end of file
+}
+
+TEST_F(CalculatorTest, excecuteSameCacheMultipleTimes) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("VAR", 2.f);
+	const auto cache = calculator.preCalculate("-1 * (11.2 * 12 / 123 * 10.4^2) * (VAR + 1) - 12");
+	const float answer = -1 * (11.2f * 12 / 123 * std::pow(10.4f, 2.f)) * (2.f + 1) - 12;
+
+	// When/Then
+	EXPECT_NEAR(answer, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_NEAR(answer, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_EQ(4, cache.getStackSize());
+}
+
+TEST_F(CalculatorTest, missingOperand) {
+	calc::Calculator calculator;
+
+	EXPECT_THROW({
+		calculator.excecute("2 *");
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, excecuteWithProvidedStack) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("VAR", 2.f);
+	const auto cache = calculator.preCalculate("(VAR + 1) * (VAR + 2)");
+	std::vector<float> stack(cache.getStackSize());
+	std::vector<float> smallStack(cache.getStackSize() - 1);
+
+	// When/Then
+	EXPECT_NEAR(12.f, calculator.excecute(cache, stack), ErrorPrecision);
+	EXPECT_THROW({
+		calculator.excecute(cache, smallStack);
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, excecuteBatch) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("a", 1.f);
+	calculator.addVariable("b", 2.f);
+	calculator.addVariable("c", 3.f);
+	const auto cache = calculator.preCalculate("a * b^2 - c / (a + 1)");
+
+	constexpr int Rows = 2 * calc::Calculator::BatchSize + 3;
+	std::vector<float> a(Rows);
+	std::vector<float> b(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		a[i] = i * 0.5f;
+		b[i] = 10.f - i;
+	}
+	const std::vector<calc::VariableColumn> columns{{"a", a}, {"b", b}};
+	std::vector<float> results(Rows);
+
+	// When
+	calculator.excecute(cache, columns, results);
+
+	// Then
+	for (int i = 0; i < Rows; ++i) {
+		calculator.updateVariable("a", a[i]);
+		calculator.updateVariable("b", b[i]);
+		EXPECT_NEAR(calculator.excecute(cache), results[i], ErrorPrecision);
+	}
+}
+
+TEST_F(CalculatorTest, excecuteBatchInvalidColumn) {
+	calc::Calculator calculator;
+	calculator.addVariable("a", 1.f);
+	const auto cache = calculator.preCalculate("a + 1");
+	std::vector<float> values(10);
+	std::vector<float> results(11);
+	const std::vector<calc::VariableColumn> missingVariable{{"b", values}};
+	const std::vector<calc::VariableColumn> tooFewValues{{"a", values}};
+
+	EXPECT_THROW({
+		calculator.excecute(cache, missingVariable, results);
+	}, calc::CalculatorException);
+
+	EXPECT_THROW({
+		calculator.excecute(cache, tooFewValues, results);
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, excecuteBatchWithAllInstructionSets) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("p", 1.f);
+	calculator.addVariable("q", 2.f);
+	calculator.addFunction("max", [](float a, float b) {
+		return std::max(a, b);
+	});
+	const auto cache = calculator.preCalculate("-p * q + p / (q + 1) - max(p, q) + p^q");
+
+	constexpr int Rows = 3 * calc::Calculator::BatchSize + 5;
+	std::vector<float> a(Rows);
+	std::vector<float> b(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		// Include negative, zero and large bases to test the pow special cases.
+		a[i] = (i % 7 == 0) ? -2.f : (i % 11 == 0 ? 0.f : i * 0.37f);
+		b[i] = (i % 5) - 1.5f + (i % 3 == 0 ? 1.5f : 0.f);
+	}
+	const std::vector<calc::VariableColumn> columns{{"p", a}, {"q", b}};
+
+	for (auto instructionSet : {calc::InstructionSet::Scalar, calc::InstructionSet::Sse2, calc::InstructionSet::Avx2}) {
+		if (!calc::isSupported(instructionSet)) {
+			continue;
+		}
+		std::vector<float> results(Rows);
+
+		// When
+		calculator.setInstructionSet(instructionSet);
+		calculator.excecute(cache, columns, results);
+
+		// Then
+		for (int i = 0; i < Rows; ++i) {
+			calculator.updateVariable("p", a[i]);
+			calculator.updateVariable("q", b[i]);
+			const float expected = calculator.excecute(cache);
+			if (std::isnan(expected)) {
+				EXPECT_TRUE(std::isnan(results[i]));
+			} else if (std::isinf(expected)) {
+				EXPECT_EQ(expected, results[i]);
+			} else {
+				EXPECT_NEAR(expected, results[i], ErrorPrecision * std::max(1.f, std::abs(expected)));
+			}
+		}
+	}
+}
+
+namespace {
+
+	float square(float a) {
+		return a * a;
+	}
+
+}
+
+TEST_F(CalculatorTest, addFunctionPointersAndLambdas) {
+	// Given
+	calc::Calculator calculator;
+	const float offset = 10.f;
+	const std::function<float(float)> negative = [](float a) {
+		return -a;
+	};
+
+	// When
+	calculator.addFunction("square", square);
+	calculator.addFunction("hypot", [](float a, float b) {
+		return std::sqrt(a * a + b * b);
+	});
+	calculator.addFunction("offset", [offset](float a) {
+		return a + offset;
+	});
+	calculator.addFunction("negative", negative);
+	calculator.addOperator('%', 3, true, [](float a, float b) {
+		return std::fmod(a, b);
+	});
+
+	// Then
+	EXPECT_NEAR(9.f, calculator.excecute("square(3)"), ErrorPrecision);
+	EXPECT_NEAR(5.f, calculator.excecute("hypot(3, 4)"), ErrorPrecision);
+	EXPECT_NEAR(12.f, calculator.excecute("offset(2)"), ErrorPrecision);
+	EXPECT_NEAR(-2.f, calculator.excecute("negative(2)"), ErrorPrecision);
+	EXPECT_NEAR(1.f, calculator.excecute("7 % 3 * 2 - 1"), ErrorPrecision);
+	EXPECT_NEAR(-16.f, calculator.excecute("negative(square(offset(-6)))"), ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, foldConstants) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.addFunction("double", [](float a) {
+		return 2 * a;
+	}, true);
+	calculator.addFunction("impure", [](float a) {
+		return 2 * a;
+	});
+	const calc::Optimization optimization;
+
+	// When/Then
+	const auto constant = calculator.preCalculate("-1 * (11.2 * 12 / 123 * 10.4^2) - 12", optimization);
+	EXPECT_EQ(1, constant.getSize());
+	EXPECT_NEAR(-1 * (11.2f * 12 / 123 * std::pow(10.4f, 2.f)) - 12, calculator.excecute(constant), ErrorPrecision);
+
+	EXPECT_EQ(1, calculator.preCalculate("(x * 1 - 0) / 1 - 0", optimization).getSize());
+	EXPECT_EQ(1, calculator.preCalculate("1 * (x^1)", optimization).getSize());
+
+	// Adding zero changes the sign of -0, i.e. is not removed.
+	EXPECT_EQ(3, calculator.preCalculate("0 + x", optimization).getSize());
+	EXPECT_EQ(3, calculator.preCalculate("x - -0", optimization).getSize());
+	calculator.updateVariable("x", -0.f);
+	EXPECT_FALSE(std::signbit(calculator.excecute(calculator.preCalculate("x + 0", optimization))));
+	EXPECT_TRUE(std::signbit(calculator.excecute(calculator.preCalculate("x - 0", optimization))));
+	calculator.updateVariable("x", 2.f);
+	EXPECT_EQ(1, calculator.preCalculate("--x", optimization).getSize());
+	EXPECT_EQ(2, calculator.preCalculate("---x", optimization).getSize());
+	EXPECT_EQ(3, calculator.preCalculate("x * double(3 + 1)", optimization).getSize());
+	EXPECT_EQ(4, calculator.preCalculate("x * impure(3 + 1)", optimization).getSize());
+	EXPECT_EQ(5, calculator.preCalculate("x * 2^3", calc::Optimization{.foldConstants = false}).getSize());
+
+	const auto cache = calculator.preCalculate("1 * (x + 0) * double(3 - 1) - -x", optimization);
+	EXPECT_NEAR(10.f, calculator.excecute(cache), ErrorPrecision);
+	calculator.updateVariable("x", 3.f);
+	EXPECT_NEAR(15.f, calculator.excecute(cache), ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, eliminateCommonSubexpressions) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("a", 2.f);
+	calculator.addVariable("b", 3.f);
+	calculator.addVariable("c", 4.f);
+	int calls = 0;
+	calculator.addFunction("impure", [&calls](float a) {
+		++calls;
+		return a;
+	});
+	const std::string expression = "(a*b/c)^2 * (a*b/c)^2 + (a*b/c)^2";
+	const float answer = std::pow(2.f * 3 / 4, 2.f) * std::pow(2.f * 3 / 4, 2.f) + std::pow(2.f * 3 / 4, 2.f);
+
+	// When
+	const auto cache = calculator.preCalculate(expression, calc::Optimization{});
+	const auto unoptimized = calculator.preCalculate(expression);
+
+	// Then
+	EXPECT_EQ(1, cache.getSlots());
+	EXPECT_LT(cache.getSize(), unoptimized.getSize());
+	EXPECT_NEAR(answer, calculator.excecute(cache), ErrorPrecision);
+
+	constexpr int Rows = calc::Calculator::BatchSize + 1;
+	std::vector<float> values(Rows, 2.f);
+	const std::vector<calc::VariableColumn> columns{{"a", values}};
+	std::vector<float> results(Rows);
+	calculator.excecute(cache, columns, results);
+	EXPECT_NEAR(answer, results.back(), ErrorPrecision);
+
+	// Impure functions are excecuted each time.
+	const auto impure = calculator.preCalculate("impure(a) + impure(a)", calc::Optimization{});
+	EXPECT_EQ(0, impure.getSlots());
+	EXPECT_NEAR(4.f, calculator.excecute(impure), ErrorPrecision);
+	EXPECT_EQ(2, calls);
+}
+
+TEST_F(CalculatorTest, tokenizeExpressions) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("aVeryLongVariableNameWithoutSso", 2.f);
+	calculator.addFunction("aVeryLongFunctionNameWithoutSso", [](float a) {
+		return a + 1;
+	});
+
+	// When/Then
+	EXPECT_NEAR(3.f, calculator.excecute("aVeryLongFunctionNameWithoutSso(aVeryLongVariableNameWithoutSso)"), ErrorPrecision);
+	EXPECT_NEAR(6.5f, calculator.excecute("\t1.5 +\n\r5 "), ErrorPrecision);
+	EXPECT_NEAR(1000.5f, calculator.excecute("1e3+.5"), ErrorPrecision);
+	EXPECT_NEAR(-1.f, calculator.excecute("-+-(-1)"), ErrorPrecision);
+	EXPECT_NEAR(-4.f, calculator.excecute("2*(-3+1)"), ErrorPrecision);
+
+	EXPECT_THROW({
+		calculator.excecute("5.3abc");
+	}, calc::CalculatorException);
+
+	EXPECT_THROW({
+		calculator.excecute("1 + nan");
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, preCalculateWithReusedContext) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 3.f);
+	calc::CompileContext context;
+	calc::Cache cache;
+
+	// When/Then
+	calculator.preCalculate("(x + 1) * (x + 1) - 2 * 3", calc::Optimization{}, context, cache);
+	EXPECT_NEAR(10.f, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_EQ(1, cache.getSlots());
+
+	calculator.preCalculate("x - 1", context, cache);
+	EXPECT_NEAR(2.f, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_EQ(0, cache.getSlots());
+
+	calculator.preCalculate("2 ^ (x + 1)", calc::Optimization{}, context, cache);
+	EXPECT_NEAR(16.f, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_EQ(calculator.preCalculate("2 ^ (x + 1)").getSize(), cache.getSize());
+
+	EXPECT_THROW({
+		calculator.preCalculate("x +", context, cache);
+	}, calc::CalculatorException);
+	calculator.preCalculate("x * x", context, cache);
+	EXPECT_NEAR(9.f, calculator.excecute(cache), ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, excecuteNestedInFunction) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addFunction("nested", [&calculator](float a) {
+		return a + calculator.excecute("1 + 2 * (3 + 4)");
+	});
+
+	// When
+	const float answer = calculator.excecute("2 * nested(1 + 1) + 1");
+
+	// Then
+	EXPECT_NEAR(35.f, answer, ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, jitFallbackNestedInFunction) {
+	// Given, reductions are excecuted by the calculator.
+	calc::Calculator calculator;
+	const std::vector<float> prices{1.f, 2.f, 3.f};
+	calculator.addArray("prices", prices);
+	std::unique_ptr<calc::JitFunction> inner;
+	calculator.addFunction("nested", [&inner](float a) {
+		return a + (*inner)(nullptr);
+	});
+	const calc::JitFunction outer{calculator, calculator.preCalculate("sum(prices) * nested(2)", calc::Optimization{false, false})};
+	inner = std::make_unique<calc::JitFunction>(calculator,
+		calculator.preCalculate("1 + (2 + (3 + (4 + (5 + (6 + (7 + (8 + sum(prices))))))))", calc::Optimization{false, false}));
+
+	// When
+	const float answer = outer(nullptr);
+
+	// Then
+	EXPECT_NEAR(6.f * (2.f + 42.f), answer, ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, manySymbols) {
+	// Given
+	calc::Calculator calculator;
+	for (int i = 0; i < 100; ++i) {
+		calculator.addVariable("variable" + std::to_string(i), static_cast<float>(i));
+	}
+
+	// When
+	calculator.updateVariable("variable99", 1000.f);
+
+	// Then
+	const auto variables = calculator.getVariables();
+	EXPECT_EQ(100, variables.size());
+	EXPECT_EQ("variable0", variables.front());
+	EXPECT_TRUE(std::is_sorted(variables.begin(), variables.end()));
+	EXPECT_TRUE(calculator.hasVariable("variable42"));
+	EXPECT_FALSE(calculator.hasVariable("variable100"));
+	EXPECT_NEAR(1042.f, calculator.excecute("variable99 + variable42"), ErrorPrecision);
+	EXPECT_NEAR(1000.f, calculator.extractVariableValue("variable99"), ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, updateVariablesWithHandles) {
+	// Given
+	calc::Calculator calculator;
+	const auto x = calculator.addVariable("x", 1.f);
+	const auto y = calculator.addVariable("y", 2.f);
+	const auto cache = calculator.preCalculate("x * 10 + y");
+
+	// When/Then
+	calculator.updateVariable(x, 3.f);
+	EXPECT_NEAR(32.f, calculator.excecute(cache), ErrorPrecision);
+	EXPECT_EQ(y.getIndex(), calculator.getVariableHandle("y").getIndex());
+
+	const std::vector<calc::VariableHandle> handles{y, x};
+	const std::vector<float> values{5.f, 4.f};
+	calculator.setVariables(handles, values);
+	EXPECT_NEAR(45.f, calculator.excecute(cache), ErrorPrecision);
+
+	const std::vector<float> all{6.f, 7.f};
+	calculator.setVariables(all);
+	EXPECT_NEAR(67.f, calculator.excecute(cache), ErrorPrecision);
+
+	EXPECT_FALSE(calc::VariableHandle{}.isValid());
+	EXPECT_THROW({
+		calculator.getVariableHandle("z");
+	}, calc::CalculatorException);
+	const std::vector<float> tooMany{1.f, 2.f, 3.f};
+	EXPECT_THROW({
+		calculator.setVariables(tooMany);
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, moreThan127VariablesAndFunctions) {
+	// Given
+	calc::Calculator calculator;
+	constexpr int Variables = 10000;
+	std::string expression;
+	for (int i = 0; i < Variables; ++i) {
+		calculator.addVariable("variable" + std::to_string(i), 1.f);
+		expression += i == 0 ? "variable0" : " + variable" + std::to_string(i);
+	}
+	for (int i = 0; i < 300; ++i) {
+		calculator.addFunction("function" + std::to_string(i), [i](float value) {
+			return value + i;
+		});
+	}
+	const auto last = calculator.addVariable("last", 2.f);
+
+	// When
+	const float sum = calculator.excecute(expression);
+	const float value = calculator.excecute("function299(last) + variable9999");
+
+	// Then
+	EXPECT_EQ(Variables, last.getIndex());
+	EXPECT_NEAR(static_cast<float>(Variables), sum, ErrorPrecision);
+	EXPECT_NEAR(302.f, value, ErrorPrecision);
+	EXPECT_TRUE(calculator.hasFunction("function299", "function299(1)"));
+	EXPECT_TRUE(calculator.hasVariable("variable9999", "variable9999 * 2"));
+}
+
+TEST_F(CalculatorTest, excecuteWithVariableContextOnManyThreads) {
+	// Given
+	calc::Calculator calculator;
+	const auto x = calculator.addVariable("x", 0.f);
+	const auto cache = calculator.preCalculate("x * x + 1");
+	constexpr int Threads = 4;
+	std::vector<float> results(Threads);
+
+	// When
+	std::vector<std::thread> threads;
+	for (int i = 0; i < Threads; ++i) {
+		threads.emplace_back([&, i]() {
+			auto context = calculator.createVariableContext();
+			float sum = 0.f;
+			for (int j = 0; j < 1000; ++j) {
+				context.updateVariable(x, static_cast<float>(i));
+				sum += calculator.excecute(cache, context);
+			}
+			results[i] = sum / 1000;
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Then
+	for (int i = 0; i < Threads; ++i) {
+		EXPECT_NEAR(i * i + 1.f, results[i], ErrorPrecision);
+	}
+	EXPECT_NEAR(0.f, calculator.extractVariableValue("x"), ErrorPrecision);
+
+	auto context = calculator.createVariableContext();
+	calculator.addVariable("y", 1.f);
+	EXPECT_THROW({
+		calculator.excecute(calculator.preCalculate("y"), context);
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, excecuteBatchInParallel) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 0.f);
+	calculator.addVariable("y", 1.f);
+	const std::vector<calc::Cache> caches{calculator.preCalculate("x * 2 + y"), calculator.preCalculate("x - y")};
+
+	constexpr int Rows = 10 * calc::Calculator::BatchSize + 3;
+	std::vector<float> x(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		x[i] = static_cast<float>(i);
+	}
+	const std::vector<calc::VariableColumn> columns{{"x", x}};
+	std::vector<float> sum(Rows);
+	std::vector<float> difference(Rows);
+	const std::vector<std::span<float>> results{sum, difference};
+	calc::ThreadPool pool{4};
+
+	// When
+	calculator.excecute(pool, caches, columns, results, 1);
+
+	// Then
+	EXPECT_EQ(4, pool.getThreads());
+	for (int i = 0; i < Rows; ++i) {
+		EXPECT_NEAR(i * 2 + 1.f, sum[i], ErrorPrecision);
+		EXPECT_NEAR(i - 1.f, difference[i], ErrorPrecision);
+	}
+
+	std::vector<float> single(Rows);
+	calculator.excecute(pool, caches.front(), columns, single, 3 * calc::Calculator::BatchSize);
+	EXPECT_EQ(sum, single);
+
+	const std::vector<float> tooFew(Rows - 1);
+	const std::vector<calc::VariableColumn> invalid{{"x", tooFew}};
+	EXPECT_THROW({
+		calculator.excecute(pool, caches.front(), invalid, single);
+	}, calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, threadPoolRethrowsException) {
+	// Given
+	calc::ThreadPool pool{3};
+	std::vector<int> counts(100);
+
+	// When/Then
+	EXPECT_THROW({
+		pool.run(counts.size(), [&](size_t index) {
+			if (index == 50) {
+				throw calc::CalculatorException{"Task failed"};
+			}
+			++counts[index];
+		});
+	}, calc::CalculatorException);
+
+	pool.run(counts.size(), [&](size_t index) {
+		++counts[index];
+	});
+	EXPECT_EQ(2, counts.front());
+	EXPECT_EQ(1, counts[50]);
+}
+
+TEST_F(CalculatorTest, doubleCalculator) {
+	// Given
+	calc::DoubleCalculator calculator;
+	calculator.addVariable("x", 16777217.0);
+	calculator.addFunction("half", [](double value) {
+		return value / 2;
+	}, true);
+	const auto cache = calculator.preCalculate("x + 0.1 + half(4) - 2", calc::Optimization{});
+
+	// When
+	const double answer = calculator.excecute(cache);
+
+	// Then
+	EXPECT_DOUBLE_EQ(16777217.1, answer);
+	EXPECT_DOUBLE_EQ(0.3, calculator.excecute("0.1 + 0.2"));
+	EXPECT_DOUBLE_EQ(1e300 * 2, calculator.excecute("1e300 * 2"));
+
+	constexpr int Rows = calc::DoubleCalculator::BatchSize + 1;
+	std::vector<double> x(Rows, 1e-10);
+	const std::vector<calc::DoubleVariableColumn> columns{{"x", x}};
+	std::vector<double> results(Rows);
+	calculator.excecute(cache, columns, results);
+	EXPECT_NEAR(1e-10 + 0.1, results.back(), 1e-12);
+
+	auto context = calculator.createVariableContext();
+	context.updateVariable(calculator.getVariableHandle("x"), 0.5);
+	EXPECT_DOUBLE_EQ(0.6, calculator.excecute(cache, context));
+}
+
+TEST_F(CalculatorTest, jitFunction) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 1.5f);
+	calculator.addVariable("y", -2.f);
+	calculator.addFunction("square", [](float value) {
+		return value * value;
+	});
+	int scale = 3;
+	calculator.addFunction("scaled", [&scale](float a, float b) {
+		return scale * a + b;
+	});
+	calculator.addFunction("atan2", [](float a, float b) {
+		return std::atan2(a, b);
+	});
+	const std::vector<float> variables{1.5f, -2.f};
+
+	// When/Then
+	for (const auto& expression : {"x + y", "x - y * 3 / (y - 1)", "-x^2 + 2^-y", "square(x) - square(y) * x",
+		"scaled(x, y) + scaled(y, x)", "atan2(x, y) / x", "1 + 2 * 3", "(x + y) * (x + y) - (x + y)", "--x", "y"}) {
+
+		for (bool optimize : {false, true}) {
+			const auto cache = calculator.preCalculate(expression, calc::Optimization{optimize, optimize});
+			const calc::JitFunction function{calculator, cache};
+			EXPECT_EQ(calc::JitFunction::isSupported(), function.isCompiled());
+			EXPECT_NEAR(calculator.excecute(cache), function(variables.data()), ErrorPrecision) << expression;
+		}
+	}
+
+	calc::JitFunction function{calculator, calculator.preCalculate("x * 2 + y")};
+	const std::vector<float> other{10.f, 1.f};
+	EXPECT_NEAR(21.f, function(other.data()), ErrorPrecision);
+	calc::JitFunction moved = std::move(function);
+	EXPECT_NEAR(21.f, moved(other.data()), ErrorPrecision);
+}
+
+TEST_F(CalculatorTest, staticExpression) {
+	// Given/When/Then, evaluated during compilation.
+	static_assert(calc::StaticExpression<"1 + 2 * 3">{}() == 7.f);
+	static_assert(calc::StaticExpression<"(1 + 2) * 3 - 4 / 2">{}() == 7.f);
+	static_assert(calc::StaticExpression<"-2^2">{}() == 4.f);
+	static_assert(calc::StaticExpression<"2^3^2">{}() == 512.f);
+	static_assert(calc::StaticExpression<"2^-1 + +1.5e1">{}() == 15.5f);
+	static_assert(calc::StaticExpression<"x * y - x", "x", "y">{}(2.f, 5) == 8.f);
+	static_assert(calc::DoubleStaticExpression<"--x - .25", "x">{}(1.0) == 0.75);
+	static_assert(calc::StaticExpression<"2 * (x + y)", "x", "y">::getSize() == 5);
+
+	// Same result as the calculator.
+	calc::Calculator calculator;
+	calculator.addVariable("x", 1.5f);
+	calculator.addVariable("y", -2.f);
+	auto expect = [&](std::string expression, float value) {
+		EXPECT_NEAR(calculator.excecute(expression), value, ErrorPrecision) << expression;
+	};
+	expect("x - y * 3 / (y - 1)", calc::StaticExpression<"x - y * 3 / (y - 1)", "x", "y">{}(1.5f, -2.f));
+	expect("-x^2 + 2^-y", calc::StaticExpression<"-x^2 + 2^-y", "x", "y">{}(1.5f, -2.f));
+	expect("x^y^2 - 1.25", calc::StaticExpression<"x^y^2 - 1.25", "x", "y">{}(1.5f, -2.f));
+	expect("x*y/x+y", calc::StaticExpression<"x*y/x+y", "x", "y">{}(1.5f, -2.f));
+	expect("(x + y) * -(x - y) / 0.5", calc::StaticExpression<"(x + y) * -(x - y) / 0.5", "x", "y">{}(1.5f, -2.f));
+}
+
+TEST_F(CalculatorTest, programLibrary) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.addVariable("unused", 0.f);
+	calculator.addVariable("y", 3.f);
+	calculator.addFunction("square", [](float value) {
+		return value * value;
+	});
+	const std::vector<std::string> expressions{"x + y * 2", "square(x - y) + 1.5", "-x^2 + (x*y) - (x*y)^2", "7"};
+	std::vector<calc::Cache> caches;
+	for (const auto& expression : expressions) {
+		caches.push_back(calculator.preCalculate(expression));
+	}
+
+	// When
+	const auto data = calc::ProgramLibrary::serialize(calculator, caches);
+	const auto path = (std::filesystem::temp_directory_path() / "calculator_programlibrary.bin").string();
+	calc::ProgramLibrary::save(path, calculator, caches);
+
+	// Then
+	const calc::ProgramLibrary library{calculator, data};
+	calc::ProgramLibrary mapped{calculator, path};
+	ASSERT_EQ(4, library.size());
+	ASSERT_EQ(4, mapped.size());
+	for (int i = 0; i < library.size(); ++i) {
+		const float expected = calculator.excecute(caches[i]);
+		EXPECT_NEAR(expected, calculator.excecute(library[i]), ErrorPrecision) << expressions[i];
+		EXPECT_NEAR(expected, calculator.excecute(mapped[i]), ErrorPrecision) << expressions[i];
+		EXPECT_NEAR(expected, calculator.excecute(calc::Cache{mapped[i]}), ErrorPrecision) << expressions[i];
+		EXPECT_EQ(caches[i].getStackSize(), mapped[i].getStackSize());
+	}
+
+	// Loaded by another calculator registering the same symbols in the same order.
+	calc::Calculator other;
+	other.addVariable("x", 10.f);
+	other.addVariable("unused", 0.f);
+	other.addVariable("y", 1.f);
+	other.addFunction("square", [](float value) {
+		return value * value;
+	});
+	other.addVariable("z", 1.f);
+	const calc::ProgramLibrary otherLibrary = std::move(mapped);
+	EXPECT_NEAR(12.f, other.excecute(calc::ProgramLibrary{other, data}[0]), ErrorPrecision);
+	EXPECT_NEAR(calculator.excecute(caches[1]), calculator.excecute(otherLibrary[1]), ErrorPrecision);
+	std::filesystem::remove(path);
+}
+
+TEST_F(CalculatorTest, programLibraryValidation) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.addVariable("y", 3.f);
+	const std::vector<calc::Cache> caches{calculator.preCalculate("x + y * 2")};
+	const auto data = calc::ProgramLibrary::serialize(calculator, caches);
+
+	// When/Then, symbols registered in another order.
+	calc::Calculator other;
+	other.addVariable("y", 3.f);
+	other.addVariable("x", 2.f);
+	EXPECT_THROW(calc::ProgramLibrary(other, data), calc::CalculatorException);
+
+	// Missing symbol.
+	EXPECT_THROW(calc::ProgramLibrary(calc::Calculator{}, data), calc::CalculatorException);
+
+	// Another value type.
+	calc::DoubleCalculator doubleCalculator;
+	doubleCalculator.addVariable("x", 2.0);
+	doubleCalculator.addVariable("y", 3.0);
+	EXPECT_THROW(calc::DoubleProgramLibrary(doubleCalculator, data), calc::CalculatorException);
+
+	// Truncated and corrupted data.
+	EXPECT_THROW(calc::ProgramLibrary(calculator, std::span{data}.first(data.size() - 8)), calc::CalculatorException);
+	auto corrupted = data;
+	corrupted[4] = std::byte{99};
+	EXPECT_THROW(calc::ProgramLibrary(calculator, corrupted), calc::CalculatorException);
+	EXPECT_THROW(calc::ProgramLibrary(calculator, "no_such_file.bin"), calc::CalculatorException);
+
+	// A slot loaded before it is stored, i.e. the store and the load of "x * y" are swapped.
+	const auto shared = calc::ProgramLibrary::serialize(calculator, std::vector<calc::Cache>{calculator.preCalculate("x * y + x * y", calc::Optimization{})});
+	EXPECT_NO_THROW(calc::ProgramLibrary(calculator, shared));
+	auto isSymbol = [&](size_t offset, calc::Type type) {
+		int32_t slot = -1;
+		std::memcpy(&slot, shared.data() + offset + 4, sizeof(slot));
+		return shared[offset] == static_cast<std::byte>(type) && slot == 0;
+	};
+	auto swapped = shared;
+	size_t store = 0;
+	while (store + 16 <= shared.size() && !(isSymbol(store, calc::Type::Store) && isSymbol(store + 8, calc::Type::Load))) {
+		store += 8;
+	}
+	ASSERT_LE(store + 16, shared.size());
+	std::swap_ranges(swapped.begin() + store, swapped.begin() + store + 8, swapped.begin() + store + 8);
+	EXPECT_THROW(calc::ProgramLibrary(calculator, swapped), calc::CalculatorException);
+	EXPECT_NO_THROW(calc::ProgramLibrary(calculator, data));
+}
+
+TEST_F(CalculatorTest, expressionCache) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.setExpressionCacheCapacity(2);
+
+	// When
+	EXPECT_NEAR(5.f, calculator.excecute("x + 3"), ErrorPrecision);
+	calculator.updateVariable("x", 3.f);
+	EXPECT_NEAR(6.f, calculator.excecute("x + 3"), ErrorPrecision);
+	EXPECT_NEAR(9.f, calculator.excecute("x * 3"), ErrorPrecision);
+	EXPECT_NEAR(6.f, calculator.excecute("x + 3"), ErrorPrecision);
+	EXPECT_NEAR(0.f, calculator.excecute("x - 3"), ErrorPrecision); // Removes "x * 3".
+	EXPECT_NEAR(6.f, calculator.excecute("x + 3"), ErrorPrecision);
+
+	// Then
+	auto statistics = calculator.getExpressionCacheStatistics();
+	EXPECT_EQ(3, statistics.hits);
+	EXPECT_EQ(3, statistics.misses);
+	EXPECT_EQ(2, statistics.size);
+	EXPECT_EQ(2, statistics.capacity);
+
+	EXPECT_NEAR(9.f, calculator.excecute("x * 3"), ErrorPrecision);
+	EXPECT_EQ(4, calculator.getExpressionCacheStatistics().misses);
+
+	// Adding a symbol clears the cache.
+	EXPECT_THROW(calculator.excecute("offset + 1"), calc::CalculatorException);
+	calculator.addVariable("offset", 10.f);
+	EXPECT_EQ(0, calculator.getExpressionCacheStatistics().size);
+	EXPECT_NEAR(11.f, calculator.excecute("offset + 1"), ErrorPrecision);
+
+	// Disabled.
+	calculator.setExpressionCacheCapacity(0);
+	EXPECT_NEAR(11.f, calculator.excecute("offset + 1"), ErrorPrecision);
+	statistics = calculator.getExpressionCacheStatistics();
+	EXPECT_EQ(0, statistics.size);
+	EXPECT_EQ(6, statistics.misses);
+}
+
+TEST_F(CalculatorTest, expressionCacheOnManyThreads) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.setExpressionCacheCapacity(4);
+	const std::vector<std::string> expressions{"x + 1", "x + 2", "x + 3", "x + 4", "x + 5", "x + 6"};
+
+	// When
+	std::vector<std::thread> threads;
+	std::vector<int> errors(4);
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < 1000; ++i) {
+				const int index = (i * 7 + t) % static_cast<int>(expressions.size());
+				if (std::abs(calculator.excecute(expressions[index]) - (3.f + index)) > ErrorPrecision) {
+					++errors[t];
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Then
+	const auto statistics = calculator.getExpressionCacheStatistics();
+	EXPECT_EQ(std::vector<int>(4, 0), errors);
+	EXPECT_EQ(4000, statistics.hits + statistics.misses);
+	EXPECT_EQ(4, statistics.size);
+}
+
+TEST_F(CalculatorTest, excecuteCacheSet) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 2.f);
+	calculator.addVariable("y", 3.f);
+	const std::vector<std::string> expressions{"x + y", "(x*y + 1) * (x*y + 1) - 2", "x^2 > 3", "-y / 4", "1.5"};
+	calculator.addOperator('>', 1, true, [](float a, float b) {
+		return a > b ? 1.f : 0.f;
+	});
+	std::vector<calc::Cache> caches;
+	for (const auto& expression : expressions) {
+		caches.push_back(calculator.preCalculate(expression, calc::Optimization{}));
+	}
+	calc::CacheSet cacheSet{caches};
+	auto context = calculator.createVariableContext();
+	context.updateVariable(calculator.getVariableHandle("x"), -1.f);
+
+	// When
+	std::vector<float> results(cacheSet.size());
+	std::vector<float> contextResults(cacheSet.size());
+	calculator.excecute(cacheSet, results);
+	calculator.excecute(cacheSet, context, contextResults);
+
+	// Then
+	ASSERT_EQ(5, cacheSet.size());
+	for (int i = 0; i < cacheSet.size(); ++i) {
+		EXPECT_NEAR(calculator.excecute(caches[i]), results[i], ErrorPrecision) << expressions[i];
+		EXPECT_NEAR(calculator.excecute(caches[i], context), contextResults[i], ErrorPrecision) << expressions[i];
+		EXPECT_EQ(caches[i].getSize(), cacheSet[i].getSize());
+	}
+	std::vector<float> tooFew(2);
+	EXPECT_THROW(calculator.excecute(cacheSet, tooFew), calc::CalculatorException);
+	EXPECT_THROW(cacheSet.add(calc::Cache{}), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, bytecode) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 1.5f);
+	calculator.addVariable("y", -2.f);
+	calculator.addFunction("square", [](float value) {
+		return value * value;
+	});
+	int scale = 3;
+	calculator.addFunction("scaled", [&scale](float a, float b) {
+		return scale * a + b;
+	});
+	calculator.addFunction("half", [](float a) {
+		return a / 2;
+	});
+	const std::vector<std::string> expressions{
+		"x + y", "x - y", "x / y", "x ^ y", "2 - x", "2 / x", "2 ^ x", "x - 2", "x / 2", "x ^ 2", "2 ^ 3 - 1",
+		"(x + 1) - (y * 2)", "(x + 1) / (y * 2)", "(x + 1) ^ (y * 2)", "x - (y * 2)", "2 / (y * 2)", "(x + 1) - y",
+		"-x", "-2", "--x", "x", "3", "square(x) + scaled(x, y) * half(y)", "scaled(2, x) - scaled(x + 1, 3)",
+		"square(x + y) * square(x + y) - (x + y)", "(x*y - 1) / (x*y - 1) + (x*y - 1)", "half(2) * x"};
+
+	// When/Then, same result as the postfix expression.
+	for (const auto& expression : expressions) {
+		for (bool optimize : {false, true}) {
+			const auto cache = calculator.preCalculate(expression, calc::Optimization{optimize, optimize});
+			EXPECT_GT(cache.getCodeSize(), 0) << expression;
+			EXPECT_LE(cache.getCodeSize(), cache.getSize() + 1) << expression; // Including the return.
+			EXPECT_EQ(calculator.excecute(calc::CacheView{cache}), calculator.excecute(cache)) << expression;
+		}
+	}
+
+	// Constants and variables are operands.
+	const auto longCache = calculator.preCalculate("2.1+-3.2*5^(3-1)/(2*3.14 - 1) + x");
+	EXPECT_LT(longCache.getCodeSize(), longCache.getSize());
+
+	// Too many registers, excecuted from the postfix expression.
+	std::string nested;
+	for (int i = 0; i < 300; ++i) {
+		nested += "(1 + ";
+	}
+	nested += "x" + std::string(300, ')');
+	const auto cache = calculator.preCalculate(nested);
+	EXPECT_EQ(0, cache.getCodeSize());
+	EXPECT_NEAR(301.5f, calculator.excecute(cache), ErrorPrecision);
+
+	// Variables added after the context was created.
+	auto context = calculator.createVariableContext();
+	calculator.addVariable("z", 1.f);
+	EXPECT_THROW(calculator.excecute(calculator.preCalculate("z + 1"), context), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, naryFunctions) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("x", 1.5f);
+	calculator.addVariable("y", -2.f);
+	calculator.addFunction("sum", [](std::span<const float> values) {
+		return std::accumulate(values.begin(), values.end(), 0.f);
+	}, true);
+	calculator.addFunction("clamp", 3, [](std::span<const float> values) {
+		return std::clamp(values[0], values[1], values[2]);
+	}, true);
+	int scale = 2;
+	calculator.addFunction("scaledLargest", calc::Calculator::Variadic, [&scale](std::span<const float> values) {
+		return scale * *std::max_element(values.begin(), values.end());
+	});
+	calculator.addFunction("square", [](float value) {
+		return value * value;
+	});
+	const std::vector<float> variables{1.5f, -2.f};
+
+	// When/Then
+	EXPECT_NEAR(3.f, calculator.excecute("sum(3)"), ErrorPrecision);
+	EXPECT_NEAR(10.f, calculator.excecute("sum(1, 2, 3, 4)"), ErrorPrecision);
+	EXPECT_NEAR(6.f, calculator.excecute("sum(x, y, sum(x, 2), 3)"), ErrorPrecision);
+	EXPECT_NEAR(136.f, calculator.excecute("sum(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16)"), ErrorPrecision);
+	EXPECT_NEAR(5.f, calculator.excecute("clamp(x * 4, 0, 5)"), ErrorPrecision);
+	EXPECT_NEAR(3.f, calculator.excecute("-scaledLargest(y, x - 3)"), ErrorPrecision);
+
+	// Same result in each way of excecuting the cache.
+	const std::vector<std::string> expressions{"sum(x, y, 1) * sum(x, y, 1) + sum(x, y)", "clamp(square(x), y, -y) - sum(x)",
+		"scaledLargest(x, 2, y) / sum(-x, 2 ^ clamp(x, 0, 1), y * y)", "sum(1, 2, sum(3, 4)) * x", "sum(x, y) - scaledLargest(x, y)"};
+	std::vector<calc::Cache> caches;
+	for (const auto& expression : expressions) {
+		for (bool optimize : {false, true}) {
+			const auto cache = calculator.preCalculate(expression, calc::Optimization{optimize, optimize});
+			const float expected = calculator.excecute(calc::CacheView{cache});
+			EXPECT_NEAR(expected, calculator.excecute(cache), ErrorPrecision) << expression;
+			EXPECT_NEAR(expected, calc::JitFunction(calculator, cache)(variables.data()), ErrorPrecision) << expression;
+
+			const std::vector<float> x(3, 1.5f);
+			const std::vector<calc::VariableColumn> columns{{"x", x}};
+			std::vector<float> results(x.size());
+			calculator.excecute(cache, columns, results);
+			EXPECT_NEAR(expected, results.back(), ErrorPrecision) << expression;
+			caches.push_back(cache);
+		}
+	}
+	const auto data = calc::ProgramLibrary::serialize(calculator, caches);
+	const calc::ProgramLibrary library{calculator, data};
+	for (int i = 0; i < library.size(); ++i) {
+		EXPECT_NEAR(calculator.excecute(caches[i]), calculator.excecute(library[i]), ErrorPrecision);
+	}
+
+	// Pure functions are folded.
+	EXPECT_EQ(1, calculator.preCalculate("sum(1, 2, clamp(4, 0, 3))", calc::Optimization{}).getSize());
+
+	// Wrong number of arguments.
+	EXPECT_THROW(calculator.preCalculate("clamp(1, 2)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("clamp(1, 2, 3, 4)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("square(1, 2)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("sum()"), calc::CalculatorException);
+	EXPECT_THROW(calculator.addFunction("none", 0, [](std::span<const float> values) {
+		return values[0];
+	}), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, arrayReductions) {
+	// Given
+	calc::Calculator calculator;
+	calculator.addVariable("rate", 0.5f);
+	std::vector<float> prices(1003);
+	std::vector<float> weights(prices.size());
+	for (size_t i = 0; i < prices.size(); ++i) {
+		prices[i] = static_cast<float>(i % 17) - 8.f;
+		weights[i] = static_cast<float>(i % 5) * 0.25f;
+	}
+	calculator.addArray("prices", prices);
+	calculator.addArray("weights", weights);
+	std::vector<float> samples(128, 1.f);
+	samples[0] = -5.f;
+	samples[32] = std::nanf("");
+	samples[64] = 5.f;
+	calculator.addArray("samples", samples);
+	const float sum = std::accumulate(prices.begin(), prices.end(), 0.f);
+	const float dot = std::inner_product(prices.begin(), prices.end(), weights.begin(), 0.f);
+
+	// When/Then
+	EXPECT_TRUE(calculator.hasArray("prices"));
+	EXPECT_FALSE(calculator.hasArray("rate"));
+	for (auto instructionSet : {calc::InstructionSet::Scalar, calc::InstructionSet::Sse2, calc::InstructionSet::Avx2}) {
+		if (!calc::isSupported(instructionSet)) {
+			continue;
+		}
+		calculator.setInstructionSet(instructionSet);
+		EXPECT_NEAR(sum, calculator.excecute("sum(prices)"), ErrorPrecision);
+		EXPECT_NEAR(sum / prices.size(), calculator.excecute("avg(prices)"), ErrorPrecision);
+		EXPECT_NEAR(-8.f, calculator.excecute("min(prices)"), ErrorPrecision);
+		EXPECT_NEAR(8.f, calculator.excecute("max(prices)"), ErrorPrecision);
+		EXPECT_NEAR(dot, calculator.excecute("dot(prices, weights)"), ErrorPrecision);
+
+		// NaN values are skipped by min and max.
+		EXPECT_NEAR(-5.f, calculator.excecute("min(samples)"), ErrorPrecision);
+		EXPECT_NEAR(5.f, calculator.excecute("max(samples)"), ErrorPrecision);
+	}
+
+	// The arrays are not copied.
+	prices[0] += 100.f;
+	EXPECT_NEAR(sum + 100.f, calculator.excecute("sum(prices)"), ErrorPrecision);
+	calculator.updateArray("prices", std::span<const float>{prices}.first(2));
+	EXPECT_NEAR(prices[0] + prices[1], calculator.excecute("sum(prices)"), ErrorPrecision);
+	calculator.updateArray("prices", prices);
+
+	// Same result in each way of excecuting the cache.
+	const std::vector<std::string> expressions{"sum(prices) * rate + 1", "sum(prices) * sum(prices) - avg(weights)",
+		"dot(prices, weights) / max(weights) + min(prices) * rate"};
+	std::vector<calc::Cache> caches;
+	for (const auto& expression : expressions) {
+		for (bool optimize : {false, true}) {
+			const auto cache = calculator.preCalculate(expression, calc::Optimization{optimize, optimize});
+			const float expected = calculator.excecute(calc::CacheView{cache});
+			EXPECT_NEAR(expected, calculator.excecute(cache), ErrorPrecision) << expression;
+			const float rate = 0.5f;
+			EXPECT_NEAR(expected, calc::JitFunction(calculator, cache)(&rate), ErrorPrecision) << expression;
+
+			const std::vector<float> rates(3, 0.5f);
+			const std::vector<calc::VariableColumn> columns{{"rate", rates}};
+			std::vector<float> results(rates.size());
+			calculator.excecute(cache, columns, results);
+			EXPECT_NEAR(expected, results.back(), ErrorPrecision) << expression;
+			caches.push_back(cache);
+		}
+	}
+	EXPECT_NEAR((sum + 100.f) * 0.5f + 1, calculator.excecute(caches[0]), ErrorPrecision);
+	const auto data = calc::ProgramLibrary::serialize(calculator, caches);
+	const calc::ProgramLibrary library{calculator, data};
+	for (int i = 0; i < library.size(); ++i) {
+		EXPECT_NEAR(calculator.excecute(caches[i]), calculator.excecute(library[i]), ErrorPrecision);
+	}
+
+	// Common reductions are only calculated once.
+	EXPECT_EQ(3, calculator.preCalculate("sum(prices) * sum(prices)").getSize());
+
+	// Arrays are only valid in reductions.
+	EXPECT_THROW(calculator.preCalculate("prices + 1"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("sum(1)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("sum(prices, weights)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.preCalculate("dot(prices)"), calc::CalculatorException);
+	EXPECT_THROW(calculator.addArray("prices", prices), calc::CalculatorException);
+	EXPECT_THROW(calculator.updateArray("rate", prices), calc::CalculatorException);
+	calculator.updateArray("weights", std::span<const float>{weights}.first(10));
+	EXPECT_THROW(calculator.excecute("dot(prices, weights)"), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, incrementalEvaluator) {
+	// Given
+	calc::Calculator calculator;
+	const auto price = calculator.addVariable("price", 10.f);
+	const auto cost = calculator.addVariable("cost", 4.f);
+	const auto rate = calculator.addVariable("rate", 2.f);
+	calculator.addFunction("sqrt", [](float value) {
+		return std::sqrt(value);
+	}, true);
+	int calls = 0;
+	calculator.addFunction("counted", [&calls](float value) {
+		++calls;
+		return value;
+	});
+	const std::string expression = "(price - cost) * rate + sqrt(cost * cost) / (rate + 1)";
+	calc::IncrementalEvaluator evaluator{calculator, calculator.preCalculate(expression, calc::Optimization{false, false})};
+
+	// When/Then
+	EXPECT_NEAR(6.f * 2.f + 4.f / 3.f, evaluator.excecute(), ErrorPrecision);
+	EXPECT_EQ(evaluator.getSize(), evaluator.getRecalculated());
+
+	// Only the path from price to the result is recalculated.
+	evaluator.updateVariable(price, 12.f);
+	EXPECT_NEAR(8.f * 2.f + 4.f / 3.f, evaluator.excecute(), ErrorPrecision);
+	EXPECT_EQ(3, evaluator.getRecalculated());
+
+	// Nothing is recalculated if the values are unchanged.
+	evaluator.updateVariable(price, 12.f);
+	EXPECT_NEAR(8.f * 2.f + 4.f / 3.f, evaluator.excecute(), ErrorPrecision);
+	EXPECT_EQ(0, evaluator.getRecalculated());
+
+	evaluator.updateVariable("cost", 3.f);
+	evaluator.updateVariable(rate, 1.f);
+	EXPECT_NEAR(9.f + 3.f / 2.f, evaluator.excecute(), ErrorPrecision);
+	EXPECT_FLOAT_EQ(3.f, evaluator.getValue(cost));
+
+	// Zero and negative zero are different values.
+	const auto zero = calculator.addVariable("zero", 0.f);
+	calc::IncrementalEvaluator inverse{calculator, calculator.preCalculate("1 / zero")};
+	EXPECT_EQ(INFINITY, inverse.excecute());
+	inverse.updateVariable(zero, -0.f);
+	EXPECT_EQ(-INFINITY, inverse.excecute());
+
+	// The calculator is not changed.
+	EXPECT_NEAR(calculator.excecute(expression), 6.f * 2.f + 4.f / 3.f, ErrorPrecision);
+
+	// Same result as the calculator with shared sub-expressions and impure functions.
+	for (const auto& shared : {"(price - cost) * (price - cost) + counted(rate) * (price - cost)", "-price + 2 * rate ^ 2"}) {
+		calc::IncrementalEvaluator incremental{calculator, calculator.preCalculate(shared)};
+		for (float value : {1.f, 2.f, 2.f, -3.f}) {
+			calculator.updateVariable(rate, value);
+			incremental.updateVariable(rate, value);
+			EXPECT_NEAR(calculator.excecute(shared), incremental.excecute(), ErrorPrecision) << shared;
+		}
+	}
+
+	// Few dirty sub-expressions in a large expression.
+	std::string sum = "price";
+	for (int i = 1; i <= 40; ++i) {
+		sum = "cost * " + std::to_string(i) + " + " + sum;
+	}
+	calc::IncrementalEvaluator large{calculator, calculator.preCalculate(sum)};
+	large.excecute();
+	large.updateVariable(price, 20.f);
+	calculator.updateVariable(price, 20.f);
+	EXPECT_NEAR(calculator.excecute(sum), large.excecute(), ErrorPrecision);
+	EXPECT_EQ(1, large.getRecalculated());
+
+	// Impure functions are called in each excecution.
+	calls = 0;
+	calc::IncrementalEvaluator impure{calculator, calculator.preCalculate("counted(price) + rate")};
+	impure.excecute();
+	impure.excecute();
+	EXPECT_EQ(2, calls);
+
+	EXPECT_THROW(evaluator.updateVariable("missing", 1.f), calc::CalculatorException);
+	EXPECT_THROW(evaluator.updateVariable(calc::VariableHandle{}, 1.f), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, formulaGraph) {
+	// Given
+	calc::Calculator calculator;
+	const auto price = calculator.addVariable("price", 10.f);
+	calculator.addVariable("cost", 4.f);
+	calc::FormulaGraph graph{calculator};
+
+	// When, formulas can use formulas added later.
+	const auto ratio = graph.addFormula("ratio", "margin / price");
+	graph.addFormula("margin", "price - cost");
+	graph.addFormula("double", "margin * 2");
+	graph.addFormula("fixed", "5 + 1");
+	graph.recalculate();
+
+	// Then
+	EXPECT_EQ(4, graph.size());
+	EXPECT_EQ(4, graph.getRecalculated());
+	EXPECT_NEAR(0.6f, graph.getValue(ratio), ErrorPrecision);
+	EXPECT_NEAR(6.f, graph.getValue("margin"), ErrorPrecision);
+	EXPECT_NEAR(12.f, calculator.excecute("double"), ErrorPrecision);
+
+	// Only the formulas depending on the changed variable are recalculated.
+	graph.updateVariable("cost", 5.f);
+	graph.recalculate();
+	EXPECT_EQ(3, graph.getRecalculated());
+	EXPECT_NEAR(0.5f, graph.getValue(ratio), ErrorPrecision);
+	EXPECT_NEAR(10.f, graph.getValue("double"), ErrorPrecision);
+
+	graph.recalculate();
+	EXPECT_EQ(0, graph.getRecalculated());
+
+	// Formulas with unchanged values do not recalculate the formulas using them.
+	graph.updateVariable(price, 11.f);
+	graph.updateVariable("cost", 6.f);
+	graph.recalculate();
+	EXPECT_EQ(2, graph.getRecalculated());
+	EXPECT_NEAR(5.f / 11.f, graph.getValue(ratio), ErrorPrecision);
+
+	// Zero and negative zero are different values.
+	const auto zero = calculator.addVariable("zero", 0.f);
+	graph.addFormula("inverse", "1 / zero");
+	graph.addFormula("sign", "1 / inverse");
+	graph.recalculate();
+	graph.updateVariable(zero, -0.f);
+	graph.recalculate();
+	EXPECT_TRUE(std::signbit(calculator.extractVariableValue("zero")));
+	EXPECT_EQ(-INFINITY, graph.getValue("inverse"));
+	EXPECT_TRUE(std::signbit(graph.getValue("sign")));
+
+	// Formulas are not variables.
+	EXPECT_THROW(graph.updateVariable("margin", 1.f), calc::CalculatorException);
+	EXPECT_THROW(graph.addFormula("price", "1"), calc::CalculatorException);
+
+	// Cycles are detected.
+	graph.addFormula("first", "second + 1");
+	graph.addFormula("second", "third * 2");
+	graph.addFormula("third", "first - price");
+	EXPECT_THROW(graph.recalculate(), calc::CalculatorException);
+}
+
+TEST_F(CalculatorTest, formulaGraphInParallel) {
+	// Given
+	calc::Calculator serialCalculator;
+	calc::Calculator parallelCalculator;
+	calc::FormulaGraph serial{serialCalculator};
+	calc::FormulaGraph parallel{parallelCalculator};
+	calc::ThreadPool pool{4};
+	constexpr int Width = 1000;
+	constexpr int Depth = 5;
+	for (auto* graph : {&serial, &parallel}) {
+		auto& calculator = graph == &serial ? serialCalculator : parallelCalculator;
+		for (int i = 0; i < Width; ++i) {
+			calculator.addVariable("in" + std::to_string(i), static_cast<float>(i % 10));
+		}
+		for (int depth = 0; depth < Depth; ++depth) {
+			for (int i = 0; i < Width; ++i) {
+				const std::string name = "f" + std::to_string(depth) + "_" + std::to_string(i);
+				if (depth == 0) {
+					graph->addFormula(name, "in" + std::to_string(i) + " * 2 + 1");
+				} else {
+					const std::string previous = "f" + std::to_string(depth - 1) + "_";
+					graph->addFormula(name, previous + std::to_string(i) + " * 0.5 + " + previous + std::to_string((i + 1) % Width) + " * 0.25");
+				}
+			}
+		}
+	}
+
+	// When
+	serial.recalculate();
+	parallel.recalculate(pool);
+	serial.updateVariable("in7", 100.f);
+	parallel.updateVariable("in7", 100.f);
+	serial.recalculate();
+	parallel.recalculate(pool);
+
+	// Then
+	EXPECT_EQ(1 + 2 + 3 + 4 + 5, parallel.getRecalculated());
+	for (int i = 0; i < Width; ++i) {
+		const std::string name = "f" + std::to_string(Depth - 1) + "_" + std::to_string(i);
+		EXPECT_NEAR(serial.getValue(name), parallel.getValue(name), ErrorPrecision);
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef CALCULATOR_CALC_BITPATTERN_H
+#define CALCULATOR_CALC_BITPATTERN_H
+
+#include <bit>
+#include <cstdint>
+
+namespace calc {
+
+	// Bit pattern of the value, used to compare constants.
+	template <class T>
+	uint64_t toBits(T value) {
+		if constexpr (sizeof(T) == sizeof(uint32_t)) {
+			return std::bit_cast<uint32_t>(value);
+		} else {
+			return std::bit_cast<uint64_t>(value);
+		}
+	}
+
+	// Values are compared by bit pattern, i.e. 0 and -0 differ and a NaN is the same as itself.
+	template <class T>
+	bool isSameValue(T a, T b) {
+		return toBits(a) == toBits(b);
+	}
+
+}
+
+#endif
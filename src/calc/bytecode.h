@@ -0,0 +1,64 @@
+#ifndef CALCULATOR_CALC_BYTECODE_H
+#define CALCULATOR_CALC_BYTECODE_H
+
+#include <cstdint>
+
+namespace calc {
+
+	// Register based instructions, lowered from the postfix expression. The registers are the slots followed by
+	// the temporary values, i.e. the same stack as used by the postfix expression. Variables and constants are
+	// operands of the instructions and are only loaded into registers when needed.
+	enum class Bytecode : uint8_t {
+		LoadVariable,		// r[destination] = variables[index]
+		LoadConstant,		// r[destination] = constants[index], 32 bit constants are stored in index
+		Move,				// r[destination] = r[a]
+		Negate,				// r[destination] = -r[a]
+		Add,				// r[destination] = r[a] + r[b]
+		Subtract,
+		Multiply,
+		Divide,
+		Pow,
+		AddVariable,		// r[destination] = r[a] + variables[index]
+		SubtractVariable,
+		MultiplyVariable,
+		DivideVariable,
+		PowVariable,
+		AddConstant,		// r[destination] = r[a] + constants[index]
+		SubtractConstant,
+		MultiplyConstant,
+		DivideConstant,
+		PowConstant,
+		VariableSubtract,	// r[destination] = variables[index] - r[a]
+		VariableDivide,
+		VariablePow,
+		ConstantSubtract,	// r[destination] = constants[index] - r[a]
+		ConstantDivide,
+		ConstantPow,
+		Call1,				// r[destination] = functions[index](r[a]), std::function
+		Call2,				// r[destination] = functions[index](r[a], r[b]), std::function
+		Call1Pointer,		// Same as Call1 for a function pointer.
+		Call2Pointer,
+		CallN,				// r[destination] = functions[index](span of r[a] to r[a + b - 1]), std::function
+		CallNPointer,		// Same as CallN for a function pointer.
+		Reduce,				// r[destination] = reduction of the symbol at index in the postfix expression
+		Return,				// return r[a]
+		ReturnVariable,		// return variables[index]
+		ReturnConstant		// return constants[index]
+	};
+
+	struct Instruction {
+		Bytecode bytecode;
+		uint8_t destination;
+		uint8_t a;
+		uint8_t b;
+		int32_t index;
+	};
+
+	static_assert(sizeof(Instruction) == 8, "Instruction should be 8 bytes");
+
+	// Register indices are stored in 8 bits, larger programs are excecuted from the postfix expression.
+	constexpr int MaxRegisters = 256;
+
+}
+
+#endif
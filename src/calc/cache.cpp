@@ -1,9 +0,0 @@
-#include "cache.h"
-
-namespace calc {
-
-	Cache::Cache(const std::vector<Symbol>& symbols)
-		: symbols_{symbols} {
-	}
-
-}
@@ -2,23 +2,190 @@
 #define CALCULATOR_CALC_CACHE_H
 
 #include "symbol.h"
+#include "bytecode.h"
+#include "calculatorexception.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 namespace calc {
 
-	class Cache {
+	class JitFunction;
+
+	template <class T>
+	class BasicCacheView;
+
+	template <class T>
+	class BasicCache {
 	public:
-		friend class Calculator;
+		template <class> friend class BasicCalculator;
+		template <class> friend class BasicCacheView;
+		template <class> friend class BasicFormulaGraph;
+		template <class> friend class BasicProgramLibrary;
+		friend class JitFunction;
 		
-		Cache() = default;
+		BasicCache() = default;
+
+		// Copies the program referenced by the view, excecuted without bytecode.
+		explicit BasicCache(const BasicCacheView<T>& view)
+			: symbols_(view.symbols_.begin(), view.symbols_.end())
+			, constants_(view.constants_.begin(), view.constants_.end())
+			, stackSize_{view.stackSize_}
+			, slots_{view.slots_} {
+		}
+
+		// Returns the number of values needed on the stack during excecution, including the slots.
+		int getStackSize() const {
+			return stackSize_;
+		}
+
+		// Returns the number of slots used to store common sub-expressions, placed at the bottom of the stack.
+		int getSlots() const {
+			return slots_;
+		}
+
+		// Returns the number of symbols in the postfix expression.
+		int getSize() const {
+			return static_cast<int>(symbols_.size());
+		}
+
+		// Returns the number of bytecode instructions, zero if excecuted from the postfix expression.
+		int getCodeSize() const {
+			return static_cast<int>(code_.size());
+		}
 		
 	private:
-		explicit Cache(const std::vector<Symbol>& symbols);
+		std::vector<Symbol> symbols_;
+		std::vector<T> constants_;
+		int stackSize_ = 0;
+		int slots_ = 0;
+		std::vector<Instruction> code_; // Uses the stack as registers.
+		int variableCount_ = 0; // Variables needed by the bytecode.
+	};
+
+	// A non-owning reference to a compiled program, e.g. a cache or a program in a ProgramLibrary.
+	template <class T>
+	class BasicCacheView {
+	public:
+		template <class> friend class BasicCalculator;
+		template <class> friend class BasicCache;
+		template <class> friend class BasicProgramLibrary;
+		template <class> friend class BasicCacheSet;
+		template <class> friend class BasicIncrementalEvaluator;
+
+		BasicCacheView() = default;
+
+		// The cache must outlive the view.
+		BasicCacheView(const BasicCache<T>& cache)
+			: symbols_{cache.symbols_}
+			, constants_{cache.constants_}
+			, stackSize_{cache.stackSize_}
+			, slots_{cache.slots_} {
+		}
+
+		int getStackSize() const {
+			return stackSize_;
+		}
+
+		int getSlots() const {
+			return slots_;
+		}
+
+		int getSize() const {
+			return static_cast<int>(symbols_.size());
+		}
+
+	private:
+		BasicCacheView(std::span<const Symbol> symbols, std::span<const T> constants, int stackSize, int slots)
+			: symbols_{symbols}
+			, constants_{constants}
+			, stackSize_{stackSize}
+			, slots_{slots} {
+		}
+
+		std::span<const Symbol> symbols_;
+		std::span<const T> constants_;
+		int stackSize_ = 0;
+		int slots_ = 0;
+	};
+
+	// Many programs packed into contiguous memory, excecuted together by the calculator against the same variables.
+	template <class T>
+	class BasicCacheSet {
+	public:
+		template <class> friend class BasicCalculator;
+
+		BasicCacheSet() = default;
+
+		explicit BasicCacheSet(std::span<const BasicCache<T>> caches) {
+			for (const auto& cache : caches) {
+				add(cache);
+			}
+		}
+
+		// Append a copy of the program, returns the index of its result.
+		int add(const BasicCacheView<T>& cache) {
+			if (cache.symbols_.empty()) {
+				throw CalculatorException{"Empty math expression"};
+			}
+			programs_.push_back({static_cast<uint32_t>(symbols_.size()), static_cast<uint32_t>(cache.symbols_.size()),
+				static_cast<uint32_t>(constants_.size()), static_cast<uint32_t>(cache.constants_.size()), cache.stackSize_, cache.slots_});
+			symbols_.insert(symbols_.end(), cache.symbols_.begin(), cache.symbols_.end());
+			constants_.insert(constants_.end(), cache.constants_.begin(), cache.constants_.end());
+			stackSize_ = std::max(stackSize_, cache.stackSize_);
+			return size() - 1;
+		}
+
+		BasicCacheView<T> operator[](int index) const {
+			const auto& program = programs_[index];
+			return {std::span<const Symbol>{symbols_}.subspan(program.symbolsBegin, program.symbolCount),
+				std::span<const T>{constants_}.subspan(program.constantsBegin, program.constantCount),
+				program.stackSize, program.slots};
+		}
+
+		int size() const {
+			return static_cast<int>(programs_.size());
+		}
+
+		// Returns the largest stack size of the programs.
+		int getStackSize() const {
+			return stackSize_;
+		}
+
+		void clear() {
+			symbols_.clear();
+			constants_.clear();
+			programs_.clear();
+			stackSize_ = 0;
+		}
+
+	private:
+		struct Program {
+			uint32_t symbolsBegin;
+			uint32_t symbolCount;
+			uint32_t constantsBegin;
+			uint32_t constantCount;
+			int stackSize;
+			int slots;
+		};
 
 		std::vector<Symbol> symbols_;
+		std::vector<T> constants_;
+		std::vector<Program> programs_;
+		int stackSize_ = 0;
 	};
 
+	using Cache = BasicCache<float>;
+	using DoubleCache = BasicCache<double>;
+
+	using CacheView = BasicCacheView<float>;
+	using DoubleCacheView = BasicCacheView<double>;
+
+	using CacheSet = BasicCacheSet<float>;
+	using DoubleCacheSet = BasicCacheSet<double>;
+
 }
 
 #endif
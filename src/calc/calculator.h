@@ -2,22 +2,76 @@
 #define CALCULATOR_CALC_CALCULATOR_H
 
 #include "symbol.h"
+#include "calculatorexception.h"
 #include "cache.h"
+#include "compilecontext.h"
+#include "symboltable.h"
+#include "variablecontext.h"
+#include "threadpool.h"
+#include "kernels.h"
+#include "expressioncache.h"
 
 #include <string>
-#include <list>
+#include <string_view>
+#include <bitset>
 #include <vector>
 #include <array>
 #include <functional>
-#include <map>
 #include <cassert>
 #include <cstdint>
+#include <span>
+#include <type_traits>
+#include <variant>
 
 namespace calc {
 
-	class Calculator {
+	// Values for a variable, one value for each row in a batch excecution.
+	template <class T>
+	struct BasicVariableColumn {
+		std::string_view name;
+		std::span<const T> values;
+	};
+
+	using VariableColumn = BasicVariableColumn<float>;
+	using DoubleVariableColumn = BasicVariableColumn<double>;
+
+	// Optimizations done by Calculator::preCalculate.
+	struct Optimization {
+		// Fold constant sub-expressions, including pure functions, and simplify x*1, x/1, x-0, x^1 and --x.
+		bool foldConstants = true;
+
+		// Excecute identical pure sub-expressions once and reuse the value stored in a slot.
+		bool eliminateCommonSubexpressions = true;
+	};
+
+	class JitFunction;
+
+	template <class T>
+	class BasicProgramLibrary;
+
+	template <class T>
+	class BasicIncrementalEvaluator;
+
+	template <class T>
+	class BasicFormulaGraph;
+
+	// Calculator for the value type T, instantiated for float and double.
+	template <class T>
+	class BasicCalculator {
 	public:
-		friend class Cache;
+		friend class JitFunction;
+		friend class BasicProgramLibrary<T>;
+		friend class BasicIncrementalEvaluator<T>;
+		friend class BasicFormulaGraph<T>;
+
+		using Cache = BasicCache<T>;
+		using CacheView = BasicCacheView<T>;
+		using CacheSet = BasicCacheSet<T>;
+		using CompileContext = BasicCompileContext<T>;
+		using VariableContext = BasicVariableContext<T>;
+		using VariableColumn = BasicVariableColumn<T>;
+		using Kernels = BasicKernels<T>;
+
 		static constexpr char UnaryMinus = '~';
 		static constexpr const char* UnaryMinusS = "~";
 
@@ -27,38 +81,149 @@ namespace calc {
 		static constexpr char Division = '/';
 		static constexpr char Pow = '^';
 
-		Calculator();
+		// Number of parameters of a function called with any number of arguments, at least one.
+		static constexpr int Variadic = -1;
 
-		Calculator(const Calculator&) = default;
-		Calculator& operator=(const Calculator&) = default;
+		static constexpr int BatchSize = 64;
+		static constexpr size_t DefaultChunkSize = 16 * BatchSize;
 
-		Calculator(Calculator&&) noexcept;
-		Calculator& operator=(Calculator&&) noexcept;
+		BasicCalculator();
+
+		BasicCalculator(const BasicCalculator&) = default;
+		BasicCalculator& operator=(const BasicCalculator&) = default;
+
+		BasicCalculator(BasicCalculator&&) noexcept;
+		BasicCalculator& operator=(BasicCalculator&&) noexcept;
 
 		Cache preCalculate(const std::string& infixNotation) const;
+
+		Cache preCalculate(const std::string& infixNotation, const Optimization& optimization) const;
+
+		// Compile into the provided cache using the buffers in the context, reusing the same context
+		// and cache results in no heap allocation once the buffers are large enough.
+		void preCalculate(std::string_view infixNotation, CompileContext& context, Cache& cache) const;
+
+		void preCalculate(std::string_view infixNotation, const Optimization& optimization,
+			CompileContext& context, Cache& cache) const;
 		
-		float excecute(Cache cache) const;
-		float excecute(const std::string& infixNotation) const;
+		// Excecute the cache using a thread local stack, i.e. no heap allocation once the stack is large enough.
+		T excecute(const Cache& cache) const;
+
+		// Excecute the cache using the provided stack, must have at least the size of cache.getStackSize().
+		T excecute(const Cache& cache, std::span<T> stack) const;
+
+		// Compiles and excecutes the expression, the compiled expression is reused if the expression cache is enabled.
+		T excecute(const std::string& infixNotation) const;
+
+		// Excecute the cache with the variable values in the context, safe to call concurrently from many threads
+		// as long as the calculator is not modified and the registered functions are thread safe.
+		T excecute(const Cache& cache, const VariableContext& context) const;
+
+		T excecute(const Cache& cache, const VariableContext& context, std::span<T> stack) const;
+
+		// Excecute a program referenced by a view, e.g. loaded from a ProgramLibrary.
+		T excecute(const CacheView& cache) const;
+
+		T excecute(const CacheView& cache, const VariableContext& context) const;
+
+		// Excecute each program in the set against the same variable values, the result of program i is written to results[i].
+		void excecute(const CacheSet& caches, std::span<T> results) const;
+
+		void excecute(const CacheSet& caches, const VariableContext& context, std::span<T> results) const;
+
+		// Returns a context with the current variable values.
+		VariableContext createVariableContext() const;
+
+		// Excecute the cache once for each row in results. Variables without a column use the current variable value.
+		// The postfix expression is interpreted once for each block of BatchSize rows.
+		void excecute(const Cache& cache, std::span<const VariableColumn> columns, std::span<T> results) const;
+
+		// Batch excecution split in chunks of rows, rounded up to a multiple of BatchSize, excecuted by the pool.
+		void excecute(ThreadPool& pool, const Cache& cache, std::span<const VariableColumn> columns,
+			std::span<T> results, size_t chunkSize = DefaultChunkSize) const;
+
+		// Batch excecution of each cache over the same columns, the results of caches[i] are written to results[i].
+		void excecute(ThreadPool& pool, std::span<const Cache> caches, std::span<const VariableColumn> columns,
+			std::span<const std::span<T>> results, size_t chunkSize = DefaultChunkSize) const;
 
+		// Set the instruction set used by the built-in operators in batch excecution.
+		void setInstructionSet(InstructionSet instructionSet);
+
+		InstructionSet getInstructionSet() const;
+
+		// Enable the cache of compiled expressions used by excecute(infixNotation), disabled with a capacity of zero.
+		// The cache is cleared when a symbol is added.
+		void setExpressionCacheCapacity(size_t capacity);
+
+		ExpressionCacheStatistics getExpressionCacheStatistics() const;
+
+		// A pure operator or function always returns the same value for the same arguments,
+		// and is excecuted by preCalculate if all arguments are constants (when folding constants).
 		void addOperator(char token, char predence, bool leftAssociative,
-			const std::function<float(float)>& function);
+			const std::function<T(T)>& function, bool pure = false);
 
 		void addOperator(char token, char predence, bool leftAssociative,
-			const std::function<float(float, float)>& function);
+			const std::function<T(T, T)>& function, bool pure = false);
+
+		// Function pointers and captureless lambdas are stored as function pointers, i.e. called without type erasure.
+		template <class Callable>
+		void addOperator(char token, char predence, bool leftAssociative, Callable&& function, bool pure = false) {
+			insertOperator(token, predence, leftAssociative, toExcecuteFunction(std::forward<Callable>(function)), pure);
+		}
+
+		void addFunction(const std::string& name, const std::function<T(T)>& function, bool pure = false);
+
+		void addFunction(const std::string& name, const std::function<T(T, T)>& function, bool pure = false);
 
-		void addFunction(const std::string& name, const std::function<float(float)>& function);
+		// Function pointers and captureless lambdas are stored as function pointers, i.e. called without type erasure.
+		// A function taking a span of values is variadic, e.g. sum(a, b, c).
+		template <class Callable>
+		void addFunction(const std::string& name, Callable&& function, bool pure = false) {
+			insertFunction(name, toExcecuteFunction(std::forward<Callable>(function)), pure);
+		}
 
-		void addFunction(const std::string& name, const std::function<float(float, float)>& function);
+		// Function taking the arguments as a span, called with exactly the number of parameters or any number if Variadic.
+		void addFunction(const std::string& name, int parameters, const std::function<T(std::span<const T>)>& function, bool pure = false);
+
+		template <class Callable>
+		void addFunction(const std::string& name, int parameters, Callable&& function, bool pure = false) {
+			insertFunction(name, toNaryFunction(std::forward<Callable>(function), parameters), pure);
+		}
 		
-		void addVariable(const std::string& name, float value);
+		VariableHandle addVariable(const std::string& name, T value);
+
+		void updateVariable(const std::string& name, T value);
+
+		// The handle must be returned by this calculator (or a copy of it).
+		void updateVariable(VariableHandle handle, T value) noexcept {
+			assert(handle.index_ >= 0 && handle.index_ < static_cast<int>(variableValues_.size()));
+			variableValues_[handle.index_] = value;
+		}
+
+		// Set the value of each variable in handles to the value with the same index in values.
+		void setVariables(std::span<const VariableHandle> handles, std::span<const T> values);
+
+		// Set the values of all variables, in the order the variables were added.
+		void setVariables(std::span<const T> values);
+
+		VariableHandle getVariableHandle(const std::string& name) const;
+
+		// Array bound to the values without copying, the values must outlive the excecutions using the array.
+		// Arrays are arguments of the built-in reductions sum, avg, min, max and dot, e.g. sum(prices) or dot(w, x),
+		// excecuted by the kernels of the instruction set. The reductions are added with the first array, except
+		// names already used by other symbols. Excecuting with a VariableContext uses the arrays of the calculator.
+		void addArray(const std::string& name, std::span<const T> values);
 
-		void updateVariable(const std::string& name, float value);
+		// Bind the array to other values, compiled expressions using the array are still valid.
+		void updateArray(const std::string& name, std::span<const T> values);
 
 		bool hasSymbol(const std::string& name) const;
 		bool hasFunction(const std::string& name) const;
 		bool hasOperator(char token) const;
 		
 		bool hasVariable(const std::string& name) const;
+
+		bool hasArray(const std::string& name) const;
 		
 		bool hasFunction(const std::string& name, const Cache& cache) const;
 		bool hasFunction(const std::string& name, const std::string& infix) const;
@@ -69,7 +234,7 @@ namespace calc {
 		bool hasVariable(const std::string& name, const std::string& infix) const;
 		bool hasVariable(const std::string& name, const Cache& cache) const;
 
-		float extractVariableValue(const std::string& name) const;
+		T extractVariableValue(const std::string& name) const;
 
 		std::vector<std::string> getVariables() const;
 
@@ -78,50 +243,249 @@ namespace calc {
 		std::vector<std::string> getFunctions() const;
 
 	private:
-		void addOperator(char token, char predence, bool leftAssociative,
-			char parameters, const std::function<float(float, float)>& function);
+		class ExcecuteFunction;
+
+		template <class Callable>
+		static ExcecuteFunction toExcecuteFunction(Callable&& function);
+
+		template <class Callable>
+		static ExcecuteFunction toNaryFunction(Callable&& function, int parameters);
+
+		void insertOperator(char token, char predence, bool leftAssociative, ExcecuteFunction function, bool pure);
+
+		void insertFunction(const std::string& name, ExcecuteFunction function, bool pure);
+
+		void insertSymbol(const std::string& name, Symbol symbol);
+
+		// Number of values the operator or function takes from the stack.
+		int getArguments(const Symbol& symbol) const {
+			return symbol.type == Type::Function ? symbol.function.arguments : functions_[symbol.op.index].getParameters();
+		}
+
+		// Index of the next operator or function added.
+		int nextFunctionIndex() const;
+
+		// Split the infix notation into symbols in a single pass, the result is written to infix
+		// and the numbers to constants.
+		void tokenize(std::string_view infixNotation, std::vector<Symbol>& infix, std::vector<T>& constants) const;
+
+		// Convert infix to postfix, the operator stack and the result are buffers reused between calls.
+		void shuntingYardAlgorithm(const std::vector<Symbol>& infix, std::vector<Symbol>& operatorStack,
+			std::vector<Symbol>& postfix) const;
+
+		int calculateStackSize(const std::vector<Symbol>& postfix) const;
+
+		// Optimize context.postfix_ in place.
+		void foldConstants(CompileContext& context) const;
 
-		void addFunction(const std::string& name, char parameters, const std::function<float(float, float)>& function);
+		// Optimize context.postfix_ in place, returns the number of slots used.
+		int eliminateCommonSubexpressions(CompileContext& context) const;
 
-		std::string addSpaceBetweenSymbols(const std::string& infixNotation) const;
-		std::list<Symbol> toSymbolList(const std::string& infixNotationWithSpaces) const;
-		std::list<Symbol> handleUnaryPlusMinusSymbol(const std::list<Symbol>& infix) const;
+		// Lower the postfix expression in the cache to bytecode, left empty if the registers do not fit.
+		void lowerToBytecode(CompileContext& context, Cache& cache) const;
 
-		std::list<Symbol> transformToSymbols(const std::string& infixNotation) const;
+		// Excecute the bytecode if available, otherwise the postfix expression.
+		T excecute(const Cache& cache, std::span<const T> variables, T* stack) const;
 
-		std::vector<Symbol> shuntingYardAlgorithm(const std::list<Symbol>& infix) const;
+		T excecute(const CacheView& cache, std::span<const T> variables, T* stack) const;
+
+		// Same as above using a thread local stack.
+		T excecuteVariables(const Cache& cache, std::span<const T> variables) const;
+
+		void excecute(const CacheSet& caches, std::span<const T> variables, std::span<T> results) const;
+
+		std::vector<const T*> resolveColumns(std::span<const VariableColumn> columns, size_t rows) const;
+
+		T reduce(const Reduction& reduction) const;
+
+		// Reductions in the cache, in the order excecuted. Excecuted once before the rows in batch excecution.
+		std::vector<T> reduce(const Cache& cache) const;
+
+		// Excecute the rows [begin, end) in blocks of BatchSize rows.
+		void excecuteRows(const Cache& cache, const Kernels& kernels, const std::vector<const T*>& columns,
+			const T* reductions, size_t begin, size_t end, T* results) const;
+
+		// The values buffer holds the arguments of an n-ary function for one row.
+		void excecuteBatch(const Cache& cache, const Kernels& kernels, const std::vector<const T*>& columns,
+			const T* reductions, size_t row, int rows, T* stack, T* values, T* results) const;
 
 		void initDefaultOperators();
 
 		class ExcecuteFunction {
 		public:
-			static constexpr int MaxArgs = 2;
+			// A built-in operation.
+			ExcecuteFunction(int parameters, Opcode opcode)
+				: parameters_{parameters}
+				, opcode_{opcode}
+				, pure_{true} {
+				
+				assert(parameters == 1 || parameters == 2);
+			}
 
-			ExcecuteFunction(int8_t parameters, const std::function<float(float, float)>& function)
+			explicit ExcecuteFunction(T (*function)(T))
+				: parameters_{1}
+				, opcode_{Opcode::UnaryPointer}
+				, function_{function} {
+			}
+
+			explicit ExcecuteFunction(T (*function)(T, T))
+				: parameters_{2}
+				, opcode_{Opcode::BinaryPointer}
+				, function_{function} {
+			}
+
+			explicit ExcecuteFunction(const std::function<T(T)>& function)
+				: parameters_{1}
+				, opcode_{Opcode::Unary}
+				, function_{function} {
+			}
+
+			explicit ExcecuteFunction(const std::function<T(T, T)>& function)
+				: parameters_{2}
+				, opcode_{Opcode::Binary}
+				, function_{function} {
+			}
+
+			ExcecuteFunction(T (*function)(std::span<const T>), int parameters)
 				: parameters_{parameters}
+				, opcode_{Opcode::NaryPointer}
+				, function_{function} {
+			}
+
+			ExcecuteFunction(const std::function<T(std::span<const T>)>& function, int parameters)
+				: parameters_{parameters}
+				, opcode_{Opcode::Nary}
 				, function_{function} {
-				
-				assert(parameters > 0 && parameters <= 2);
 			}
 
-			Float excecute(const std::array<float, MaxArgs>& args) const {
-				return Float::create(function_(args[0], args[1])).value;
+			// Only valid for Opcode::UnaryPointer.
+			T (*getUnaryPointer() const)(T) {
+				return get<T (*)(T)>();
 			}
 
-			int8_t getParameters() const {
+			// Only valid for Opcode::BinaryPointer.
+			T (*getBinaryPointer() const)(T, T) {
+				return get<T (*)(T, T)>();
+			}
+
+			// Only valid for Opcode::UnaryPointer.
+			T callPointer(T a) const {
+				return get<T (*)(T)>()(a);
+			}
+
+			// Only valid for Opcode::BinaryPointer.
+			T callPointer(T a, T b) const {
+				return get<T (*)(T, T)>()(a, b);
+			}
+
+			// Only valid for Opcode::Unary.
+			T call(T a) const {
+				return get<std::function<T(T)>>()(a);
+			}
+
+			// Only valid for Opcode::Binary.
+			T call(T a, T b) const {
+				return get<std::function<T(T, T)>>()(a, b);
+			}
+
+			// Only valid for Opcode::NaryPointer.
+			T callPointer(std::span<const T> arguments) const {
+				return get<T (*)(std::span<const T>)>()(arguments);
+			}
+
+			// Only valid for Opcode::Nary.
+			T call(std::span<const T> arguments) const {
+				return get<std::function<T(std::span<const T>)>>()(arguments);
+			}
+
+			// Excecute the function for any opcode except n-ary functions, the argument b is ignored by unary functions.
+			T excecute(T a, T b) const;
+
+			// Excecute the function for any opcode.
+			T excecute(std::span<const T> arguments) const;
+
+			// Returns Variadic for a function taking any number of arguments.
+			int getParameters() const {
 				return parameters_;
 			}
 
+			bool isValidArguments(int arguments) const {
+				return parameters_ == Variadic ? arguments > 0 : arguments == parameters_;
+			}
+
+			Opcode getOpcode() const {
+				return opcode_;
+			}
+
+			void setPure(bool pure) {
+				pure_ = pure;
+			}
+
+			bool isPure() const {
+				return pure_;
+			}
+
 		private:
-			int8_t parameters_ = 0;
-			std::function<float(float, float)> function_;
+			// The alternative is given by the opcode, i.e. not checked.
+			template <class Function>
+			const Function& get() const {
+				return *std::get_if<Function>(&function_);
+			}
+
+			int parameters_ = 0;
+			Opcode opcode_;
+			bool pure_ = false;
+			std::variant<std::monostate, T (*)(T), T (*)(T, T), T (*)(std::span<const T>),
+				std::function<T(T)>, std::function<T(T, T)>, std::function<T(std::span<const T>)>> function_;
 		};
 
-		std::map<std::string, Symbol> symbols_;
+		SymbolTable symbols_;
 		std::vector<ExcecuteFunction> functions_;
-		std::vector<float> variableValues_;
+		std::vector<T> variableValues_;
+		std::vector<std::span<const T>> arrays_;
+		std::bitset<256> singleCharSymbols_;
+		Symbol unaryMinus_;
+		InstructionSet instructionSet_ = getSupportedInstructionSet();
+		mutable BasicExpressionCache<T> expressionCache_;
 	};
 
+	template <class T>
+	template <class Callable>
+	typename BasicCalculator<T>::ExcecuteFunction BasicCalculator<T>::toExcecuteFunction(Callable&& function) {
+		if constexpr (std::is_convertible_v<Callable, T (*)(T)>) {
+			return ExcecuteFunction{static_cast<T (*)(T)>(function)};
+		} else if constexpr (std::is_convertible_v<Callable, T (*)(T, T)>) {
+			return ExcecuteFunction{static_cast<T (*)(T, T)>(function)};
+		} else if constexpr (std::is_invocable_r_v<T, Callable, T>) {
+			return ExcecuteFunction{std::function<T(T)>{std::forward<Callable>(function)}};
+		} else if constexpr (std::is_invocable_r_v<T, Callable, std::span<const T>>) {
+			return toNaryFunction(std::forward<Callable>(function), Variadic);
+		} else {
+			static_assert(std::is_invocable_r_v<T, Callable, T, T>, "Function must take one or two arguments or a span of the value type");
+			return ExcecuteFunction{std::function<T(T, T)>{std::forward<Callable>(function)}};
+		}
+	}
+
+	template <class T>
+	template <class Callable>
+	typename BasicCalculator<T>::ExcecuteFunction BasicCalculator<T>::toNaryFunction(Callable&& function, int parameters) {
+		if (parameters != Variadic && (parameters < 1 || parameters > MaxArguments)) {
+			throw CalculatorException{"Function could not be added, invalid number of parameters"};
+		}
+		if constexpr (std::is_convertible_v<Callable, T (*)(std::span<const T>)>) {
+			return ExcecuteFunction{static_cast<T (*)(std::span<const T>)>(function), parameters};
+		} else {
+			static_assert(std::is_invocable_r_v<T, Callable, std::span<const T>>, "Function must take a span of the value type");
+			return ExcecuteFunction{std::function<T(std::span<const T>)>{std::forward<Callable>(function)}, parameters};
+		}
+	}
+
+	extern template class BasicCalculator<float>;
+	extern template class BasicCalculator<double>;
+
+	using Calculator = BasicCalculator<float>;
+	using DoubleCalculator = BasicCalculator<double>;
+
 }
 
 #endif
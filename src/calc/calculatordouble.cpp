@@ -0,0 +1,7 @@
+#include "calculatorimpl.h"
+
+namespace calc {
+
+	template class BasicCalculator<double>;
+
+}
@@ -0,0 +1,1764 @@
+#ifndef CALCULATOR_CALC_CALCULATORIMPL_H
+#define CALCULATOR_CALC_CALCULATORIMPL_H
+
+// Definitions of BasicCalculator, included by the source files instantiating it. Each value type is
+// instantiated in its own translation unit, so the inlining budget of the compiler is not shared.
+
+#include "bitpattern.h"
+#include "calculator.h"
+#include "calculatorexception.h"
+
+#include <sstream>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <utility>
+#include <bit>
+#include <charconv>
+#include <cctype>
+#include <limits>
+
+// Used for the opcode dispatch in the excecution loop.
+#if defined(_MSC_VER)
+#define CALCULATOR_FORCE_INLINE __forceinline
+#else
+#define CALCULATOR_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace {
+
+	template <class... Args>
+	std::string concatToString(Args&&... args) {
+		std::stringstream stream;
+		((stream << std::forward<Args>(args)), ...);
+		return stream.str();
+	}
+
+	std::string charToString(char token) {
+		return std::string(1, token);
+	}
+
+	// Thread local buffer reused between calls. A nested call on the same thread (e.g. a registered
+	// function calling the calculator) gets its own buffer instead.
+	template <class Buffer>
+	class ThreadLocalBuffer {
+	public:
+		ThreadLocalBuffer()
+			: nested_{inUse_} {
+
+			inUse_ = true;
+		}
+
+		~ThreadLocalBuffer() {
+			if (!nested_) {
+				inUse_ = false;
+			}
+		}
+
+		ThreadLocalBuffer(const ThreadLocalBuffer&) = delete;
+		ThreadLocalBuffer& operator=(const ThreadLocalBuffer&) = delete;
+
+		Buffer& get() {
+			return nested_ ? local_ : buffer_;
+		}
+
+	private:
+		static thread_local Buffer buffer_;
+		static thread_local bool inUse_;
+
+		bool nested_;
+		Buffer local_;
+	};
+
+	template <class Buffer>
+	thread_local Buffer ThreadLocalBuffer<Buffer>::buffer_;
+
+	template <class Buffer>
+	thread_local bool ThreadLocalBuffer<Buffer>::inUse_ = false;
+
+	// Excecute the opcode on the stack, top points to the next free slot. Built-in operations are excecuted directly
+	// on the stack, arguments is only used by n-ary functions. A free function since the attribute is only respected
+	// on the first declaration.
+	template <class Function, class T>
+	CALCULATOR_FORCE_INLINE T* excecuteOpcode(const std::vector<Function>& functions, calc::Opcode opcode, int index,
+		int arguments, T* top) {
+
+		switch (opcode) {
+			case calc::Opcode::Negate:
+				top[-1] = -top[-1];
+				return top;
+			case calc::Opcode::Add:
+				top[-2] += top[-1];
+				return top - 1;
+			case calc::Opcode::Subtract:
+				top[-2] -= top[-1];
+				return top - 1;
+			case calc::Opcode::Multiply:
+				top[-2] *= top[-1];
+				return top - 1;
+			case calc::Opcode::Divide:
+				top[-2] /= top[-1];
+				return top - 1;
+			case calc::Opcode::Pow:
+				top[-2] = std::pow(top[-2], top[-1]);
+				return top - 1;
+			case calc::Opcode::Unary:
+				top[-1] = functions[index].call(top[-1]);
+				return top;
+			case calc::Opcode::Binary:
+				top[-2] = functions[index].call(top[-2], top[-1]);
+				return top - 1;
+			case calc::Opcode::UnaryPointer:
+				top[-1] = functions[index].callPointer(top[-1]);
+				return top;
+			case calc::Opcode::BinaryPointer:
+				top[-2] = functions[index].callPointer(top[-2], top[-1]);
+				return top - 1;
+			case calc::Opcode::Nary:
+				top -= arguments;
+				*top = functions[index].call(std::span<const T>{top, static_cast<size_t>(arguments)});
+				return top + 1;
+			case calc::Opcode::NaryPointer:
+				top -= arguments;
+				*top = functions[index].callPointer(std::span<const T>{top, static_cast<size_t>(arguments)});
+				return top + 1;
+		}
+		return top;
+	}
+
+#if defined(__GNUC__)
+#define CALCULATOR_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // Labels as values.
+#endif
+
+	// Constant operand of an instruction, 32 bit values are stored in the instruction and wider values in the cache.
+	template <class T>
+	int32_t toConstantOperand(const std::vector<T>& constants, int index) {
+		if constexpr (sizeof(T) == sizeof(int32_t)) {
+			return std::bit_cast<int32_t>(constants[index]);
+		} else {
+			return index;
+		}
+	}
+
+	template <class T>
+	CALCULATOR_FORCE_INLINE T constantOperand(const calc::Instruction* instruction, const T* constants) {
+		if constexpr (sizeof(T) == sizeof(int32_t)) {
+			return std::bit_cast<T>(instruction->index);
+		} else {
+			return constants[instruction->index];
+		}
+	}
+
+	// Excecute the bytecode using the stack as registers. Uses computed goto where supported, i.e. each
+	// instruction jumps directly to the next, otherwise a switch in a loop. Reduce returns the value of
+	// the reduction at an index in the postfix expression.
+	template <class Function, class T, class Reduce>
+	T excecuteBytecode(const std::vector<Function>& functions, const calc::Instruction* instruction,
+		const T* constants, const T* variables, T* r, const Reduce& reduce) {
+
+		using calc::Bytecode;
+#ifdef CALCULATOR_THREADED_DISPATCH
+		// In the same order as Bytecode.
+		static constexpr void* Labels[] = {
+			&&LoadVariable, &&LoadConstant, &&Move, &&Negate,
+			&&Add, &&Subtract, &&Multiply, &&Divide, &&Pow,
+			&&AddVariable, &&SubtractVariable, &&MultiplyVariable, &&DivideVariable, &&PowVariable,
+			&&AddConstant, &&SubtractConstant, &&MultiplyConstant, &&DivideConstant, &&PowConstant,
+			&&VariableSubtract, &&VariableDivide, &&VariablePow, &&ConstantSubtract, &&ConstantDivide, &&ConstantPow,
+			&&Call1, &&Call2, &&Call1Pointer, &&Call2Pointer, &&CallN, &&CallNPointer, &&Reduce,
+			&&Return, &&ReturnVariable, &&ReturnConstant
+		};
+#define CALCULATOR_CASE(name) name
+#define CALCULATOR_NEXT goto *Labels[static_cast<int>((++instruction)->bytecode)]
+		goto *Labels[static_cast<int>(instruction->bytecode)];
+#else
+#define CALCULATOR_CASE(name) case Bytecode::name
+#define CALCULATOR_NEXT ++instruction; continue
+		for (;;) switch (instruction->bytecode) {
+#endif
+		CALCULATOR_CASE(LoadVariable):
+			r[instruction->destination] = variables[instruction->index];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(LoadConstant):
+			r[instruction->destination] = constantOperand(instruction, constants);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Move):
+			r[instruction->destination] = r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Negate):
+			r[instruction->destination] = -r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Add):
+			r[instruction->destination] = r[instruction->a] + r[instruction->b];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Subtract):
+			r[instruction->destination] = r[instruction->a] - r[instruction->b];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Multiply):
+			r[instruction->destination] = r[instruction->a] * r[instruction->b];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Divide):
+			r[instruction->destination] = r[instruction->a] / r[instruction->b];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Pow):
+			r[instruction->destination] = std::pow(r[instruction->a], r[instruction->b]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(AddVariable):
+			r[instruction->destination] = r[instruction->a] + variables[instruction->index];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(SubtractVariable):
+			r[instruction->destination] = r[instruction->a] - variables[instruction->index];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(MultiplyVariable):
+			r[instruction->destination] = r[instruction->a] * variables[instruction->index];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(DivideVariable):
+			r[instruction->destination] = r[instruction->a] / variables[instruction->index];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(PowVariable):
+			r[instruction->destination] = std::pow(r[instruction->a], variables[instruction->index]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(AddConstant):
+			r[instruction->destination] = r[instruction->a] + constantOperand(instruction, constants);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(SubtractConstant):
+			r[instruction->destination] = r[instruction->a] - constantOperand(instruction, constants);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(MultiplyConstant):
+			r[instruction->destination] = r[instruction->a] * constantOperand(instruction, constants);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(DivideConstant):
+			r[instruction->destination] = r[instruction->a] / constantOperand(instruction, constants);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(PowConstant):
+			r[instruction->destination] = std::pow(r[instruction->a], constantOperand(instruction, constants));
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(VariableSubtract):
+			r[instruction->destination] = variables[instruction->index] - r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(VariableDivide):
+			r[instruction->destination] = variables[instruction->index] / r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(VariablePow):
+			r[instruction->destination] = std::pow(variables[instruction->index], r[instruction->a]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(ConstantSubtract):
+			r[instruction->destination] = constantOperand(instruction, constants) - r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(ConstantDivide):
+			r[instruction->destination] = constantOperand(instruction, constants) / r[instruction->a];
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(ConstantPow):
+			r[instruction->destination] = std::pow(constantOperand(instruction, constants), r[instruction->a]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Call1):
+			r[instruction->destination] = functions[instruction->index].call(r[instruction->a]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Call2):
+			r[instruction->destination] = functions[instruction->index].call(r[instruction->a], r[instruction->b]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Call1Pointer):
+			r[instruction->destination] = functions[instruction->index].callPointer(r[instruction->a]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Call2Pointer):
+			r[instruction->destination] = functions[instruction->index].callPointer(r[instruction->a], r[instruction->b]);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(CallN):
+			r[instruction->destination] = functions[instruction->index].call(std::span<const T>{r + instruction->a, instruction->b});
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(CallNPointer):
+			r[instruction->destination] = functions[instruction->index].callPointer(std::span<const T>{r + instruction->a, instruction->b});
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Reduce):
+			r[instruction->destination] = reduce(instruction->index);
+			CALCULATOR_NEXT;
+		CALCULATOR_CASE(Return):
+			return r[instruction->a];
+		CALCULATOR_CASE(ReturnVariable):
+			return variables[instruction->index];
+		CALCULATOR_CASE(ReturnConstant):
+			return constantOperand(instruction, constants);
+#ifndef CALCULATOR_THREADED_DISPATCH
+		}
+#endif
+#undef CALCULATOR_CASE
+#undef CALCULATOR_NEXT
+	}
+
+#ifdef CALCULATOR_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+namespace calc {
+
+	template <class T>
+	BasicCalculator<T>::BasicCalculator() {
+		initDefaultOperators();
+	}
+
+	template <class T>
+	BasicCalculator<T>::BasicCalculator(BasicCalculator&& other) noexcept
+		: symbols_{std::move(other.symbols_)}
+		, functions_{std::move(other.functions_)}
+		, variableValues_{std::move(other.variableValues_)}
+		, arrays_{std::move(other.arrays_)}
+		, singleCharSymbols_{other.singleCharSymbols_}
+		, unaryMinus_{other.unaryMinus_}
+		, instructionSet_{other.instructionSet_}
+		, expressionCache_{other.expressionCache_} {
+		
+		other.singleCharSymbols_.reset();
+		other.initDefaultOperators();
+	}
+
+	template <class T>
+	BasicCalculator<T>& BasicCalculator<T>::operator=(BasicCalculator&& other) noexcept {
+		symbols_ = std::move(other.symbols_);
+		functions_ = std::move(other.functions_);
+		variableValues_ = std::move(other.variableValues_);
+		arrays_ = std::move(other.arrays_);
+		singleCharSymbols_ = other.singleCharSymbols_;
+		unaryMinus_ = other.unaryMinus_;
+		instructionSet_ = other.instructionSet_;
+		expressionCache_ = other.expressionCache_;
+		
+		other.singleCharSymbols_.reset();
+		other.initDefaultOperators();
+		return *this;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::initDefaultOperators() {
+		insertOperator(UnaryMinus, 5, false, ExcecuteFunction{1, Opcode::Negate}, true);
+		insertOperator(Plus, 2, true, ExcecuteFunction{2, Opcode::Add}, true);
+		insertOperator(Minus, 2, true, ExcecuteFunction{2, Opcode::Subtract}, true);
+		insertOperator(Division, 3, true, ExcecuteFunction{2, Opcode::Divide}, true);
+		insertOperator(Multiplication, 3, true, ExcecuteFunction{2, Opcode::Multiply}, true);
+		insertOperator(Pow, 4, false, ExcecuteFunction{2, Opcode::Pow}, true);
+		
+		insertSymbol(",", Comma::create());
+		insertSymbol("(", Paranthes::create(true));
+		insertSymbol(")", Paranthes::create(false));
+		unaryMinus_ = *symbols_.find(UnaryMinusS);
+	}
+
+	template <class T>
+	BasicCache<T> BasicCalculator<T>::preCalculate(const std::string& infixNotation) const {
+		return preCalculate(infixNotation, Optimization{.foldConstants = false, .eliminateCommonSubexpressions = false});
+	}
+
+	template <class T>
+	BasicCache<T> BasicCalculator<T>::preCalculate(const std::string& infixNotation, const Optimization& optimization) const {
+		Cache cache;
+		ThreadLocalBuffer<CompileContext> context;
+		preCalculate(infixNotation, optimization, context.get(), cache);
+		return cache;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::preCalculate(std::string_view infixNotation, CompileContext& context, Cache& cache) const {
+		preCalculate(infixNotation, Optimization{.foldConstants = false, .eliminateCommonSubexpressions = false}, context, cache);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::preCalculate(std::string_view infixNotation, const Optimization& optimization,
+		CompileContext& context, Cache& cache) const {
+
+		tokenize(infixNotation, context.infix_, context.constants_);
+		shuntingYardAlgorithm(context.infix_, context.operators_, context.postfix_);
+		int stackSize = calculateStackSize(context.postfix_); // Validates the expression before optimizing.
+		int slots = 0;
+		if (optimization.foldConstants) {
+			foldConstants(context);
+			stackSize = calculateStackSize(context.postfix_);
+		}
+		if (optimization.eliminateCommonSubexpressions) {
+			slots = eliminateCommonSubexpressions(context);
+			stackSize = calculateStackSize(context.postfix_);
+		}
+		cache.symbols_.assign(context.postfix_.begin(), context.postfix_.end());
+
+		// Only the constants still used after optimizing are kept in the cache.
+		cache.constants_.clear();
+		for (auto& symbol : cache.symbols_) {
+			if (symbol.type == Type::Constant) {
+				cache.constants_.push_back(context.constants_[symbol.constant.index]);
+				symbol.constant.index = static_cast<int32_t>(cache.constants_.size()) - 1;
+			}
+		}
+		cache.stackSize_ = slots + stackSize;
+		cache.slots_ = slots;
+		lowerToBytecode(context, cache);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::lowerToBytecode(CompileContext& context, Cache& cache) const {
+		using Operand = typename CompileContext::Operand;
+		using OperandType = typename CompileContext::OperandType;
+
+		auto& code = cache.code_;
+		auto& operands = context.operands_;
+		code.clear();
+		operands.clear();
+		if (cache.symbols_.empty()) {
+			return;
+		}
+		const int slots = cache.slots_; // Register of the first temporary value.
+		int maxSize = 0;
+		int variableCount = 0;
+
+		auto emit = [&](Bytecode bytecode, int destination, int a, int b, int index) {
+			code.push_back({bytecode, static_cast<uint8_t>(destination), static_cast<uint8_t>(a), static_cast<uint8_t>(b), index});
+		};
+		auto loadBytecode = [](const Operand& operand) {
+			return operand.type == OperandType::Variable ? Bytecode::LoadVariable : Bytecode::LoadConstant;
+		};
+		// Load the operand into the register if not already in a register.
+		auto load = [&](Operand& operand, int destination) {
+			if (operand.type != OperandType::Register) {
+				emit(loadBytecode(operand), destination, 0, 0, operand.index);
+				operand = {destination, OperandType::Register};
+			}
+		};
+		// Bytecode in the group starting with first, in the same order as Opcode::Add to Opcode::Pow.
+		auto offset = [](Bytecode first, Opcode opcode) {
+			return static_cast<Bytecode>(static_cast<int>(first) + static_cast<int>(opcode) - static_cast<int>(Opcode::Add));
+		};
+
+		for (const auto& symbol : cache.symbols_) {
+			switch (symbol.type) {
+				case Type::Constant:
+					operands.push_back({toConstantOperand(cache.constants_, symbol.constant.index), OperandType::Constant});
+					break;
+				case Type::Variable:
+					operands.push_back({symbol.variable.index, OperandType::Variable});
+					variableCount = std::max(variableCount, symbol.variable.index + 1);
+					break;
+				case Type::Load:
+					operands.push_back({symbol.load.slot, OperandType::Register});
+					break;
+				case Type::Reduction:
+				{
+					const int destination = slots + static_cast<int>(operands.size());
+					emit(Bytecode::Reduce, destination, 0, 0, static_cast<int>(&symbol - cache.symbols_.data()));
+					operands.push_back({destination, OperandType::Register});
+					break;
+				}
+				case Type::Store:
+				{
+					const auto& top = operands.back();
+					if (top.type == OperandType::Register) {
+						emit(Bytecode::Move, symbol.store.slot, top.index, 0, 0);
+					} else {
+						emit(loadBytecode(top), symbol.store.slot, 0, 0, top.index);
+					}
+					break;
+				}
+				case Type::Operator:
+					[[fallthrough]];
+				case Type::Function:
+				{
+					const int index = symbol.type == Type::Function ? symbol.function.index : symbol.op.index;
+					const auto opcode = symbol.type == Type::Function ? symbol.function.opcode : symbol.op.opcode;
+					const int arguments = getArguments(symbol);
+					const int position = static_cast<int>(operands.size()) - arguments;
+					const int destination = slots + position;
+					Operand& a = operands[position];
+					switch (opcode) {
+						case Opcode::Negate:
+							load(a, destination);
+							emit(Bytecode::Negate, destination, a.index, 0, 0);
+							break;
+						case Opcode::Unary:
+							[[fallthrough]];
+						case Opcode::UnaryPointer:
+							load(a, destination);
+							emit(opcode == Opcode::Unary ? Bytecode::Call1 : Bytecode::Call1Pointer, destination, a.index, 0, index);
+							break;
+						case Opcode::Binary:
+							[[fallthrough]];
+						case Opcode::BinaryPointer:
+						{
+							Operand& b = operands[position + 1];
+							load(a, destination);
+							load(b, destination + 1);
+							emit(opcode == Opcode::Binary ? Bytecode::Call2 : Bytecode::Call2Pointer, destination, a.index, b.index, index);
+							break;
+						}
+						case Opcode::Nary:
+							[[fallthrough]];
+						case Opcode::NaryPointer:
+							if (arguments > std::numeric_limits<uint8_t>::max()) {
+								code.clear();
+								return;
+							}
+							// The arguments are passed as a span, i.e. in consecutive registers.
+							for (int i = 0; i < arguments; ++i) {
+								Operand& operand = operands[position + i];
+								if (operand.type != OperandType::Register) {
+									load(operand, destination + i);
+								} else if (operand.index != destination + i) {
+									emit(Bytecode::Move, destination + i, operand.index, 0, 0);
+								}
+							}
+							emit(opcode == Opcode::Nary ? Bytecode::CallN : Bytecode::CallNPointer, destination, destination, arguments, index);
+							break;
+						default:
+						{
+							// Add, Subtract, Multiply, Divide and Pow with at most one operand not in a register.
+							Operand& b = operands[position + 1];
+							if (a.type != OperandType::Register && b.type != OperandType::Register) {
+								load(a, destination);
+							}
+							const bool commutative = opcode == Opcode::Add || opcode == Opcode::Multiply;
+							if (a.type == OperandType::Register && b.type == OperandType::Register) {
+								emit(offset(Bytecode::Add, opcode), destination, a.index, b.index, 0);
+							} else if (a.type == OperandType::Register) {
+								const auto first = b.type == OperandType::Variable ? Bytecode::AddVariable : Bytecode::AddConstant;
+								emit(offset(first, opcode), destination, a.index, 0, b.index);
+							} else if (commutative) {
+								const auto first = a.type == OperandType::Variable ? Bytecode::AddVariable : Bytecode::AddConstant;
+								emit(offset(first, opcode), destination, b.index, 0, a.index);
+							} else {
+								// Subtract, Divide or Pow with the first operand not in a register.
+								const auto first = a.type == OperandType::Variable ? Bytecode::VariableSubtract : Bytecode::ConstantSubtract;
+								const int group = opcode == Opcode::Subtract ? 0 : opcode == Opcode::Divide ? 1 : 2;
+								emit(static_cast<Bytecode>(static_cast<int>(first) + group), destination, b.index, 0, a.index);
+							}
+							break;
+						}
+					}
+					operands.resize(position);
+					operands.push_back({destination, OperandType::Register});
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					break;
+			}
+			maxSize = std::max(maxSize, static_cast<int>(operands.size()));
+		}
+		const auto& top = operands.back();
+		const auto returnBytecode = top.type == OperandType::Register ? Bytecode::Return
+			: top.type == OperandType::Variable ? Bytecode::ReturnVariable : Bytecode::ReturnConstant;
+		emit(returnBytecode, 0, top.type == OperandType::Register ? top.index : 0, 0, top.index);
+
+		cache.variableCount_ = variableCount;
+		if (slots + maxSize > MaxRegisters) {
+			code.clear();
+		}
+	}
+
+	template <class T>
+	void BasicCalculator<T>::foldConstants(CompileContext& context) const {
+		using Node = typename CompileContext::FoldNode;
+
+		// Compared by bit pattern, x - -0 is not x for x = -0.
+		auto isValue = [](const Node& node, T value) {
+			return node.constant && isSameValue(node.value, value);
+		};
+
+		auto& output = context.output_;
+		auto& nodes = context.foldNodes_;
+		output.clear();
+		nodes.clear();
+		for (const auto& symbol : context.postfix_) {
+			switch (symbol.type) {
+				case Type::Constant:
+					nodes.push_back({output.size(), true, context.constants_[symbol.constant.index]});
+					output.push_back(symbol);
+					break;
+				case Type::Variable:
+					[[fallthrough]];
+				case Type::Reduction:
+					nodes.push_back({output.size(), false, T{}});
+					output.push_back(symbol);
+					break;
+				case Type::Operator:
+					[[fallthrough]];
+				case Type::Function:
+				{
+					const int index = symbol.type == Type::Function ? symbol.function.index : symbol.op.index;
+					const auto opcode = symbol.type == Type::Function ? symbol.function.opcode : symbol.op.opcode;
+					const auto& f = functions_[index];
+					const int arguments = getArguments(symbol);
+					const bool binary = arguments == 2;
+					const auto first = nodes.end() - arguments;
+					const Node a = *first;
+					const Node b = nodes.back();
+					const bool constant = std::all_of(first, nodes.end(), [](const Node& node) {
+						return node.constant;
+					});
+					if (f.isPure() && constant) {
+						context.arguments_.clear();
+						for (auto it = first; it != nodes.end(); ++it) {
+							context.arguments_.push_back(it->value);
+						}
+					}
+					nodes.erase(first, nodes.end());
+
+					if (f.isPure() && constant) {
+						const T value = f.excecute(context.arguments_);
+						output.resize(a.begin);
+						context.constants_.push_back(value);
+						output.push_back(Constant::create(static_cast<int>(context.constants_.size()) - 1));
+						nodes.push_back({a.begin, true, value});
+					} else if (binary && ((isValue(b, T{1}) && (opcode == Opcode::Multiply || opcode == Opcode::Divide || opcode == Opcode::Pow))
+						|| (isValue(b, T{0}) && opcode == Opcode::Subtract))) {
+						// x*1, x/1, x^1, x-0 = x. Not x+0, since -0 + 0 is 0.
+						output.resize(b.begin);
+						nodes.push_back(a);
+					} else if (binary && isValue(a, T{1}) && opcode == Opcode::Multiply) {
+						// 1*x = x
+						output.erase(output.begin() + a.begin, output.begin() + b.begin);
+						nodes.push_back({a.begin, b.constant, b.value});
+					} else if (opcode == Opcode::Negate && output.back().type == Type::Operator && output.back().op.opcode == Opcode::Negate) {
+						// --x = x
+						output.pop_back();
+						nodes.push_back(a);
+					} else {
+						output.push_back(symbol);
+						nodes.push_back({a.begin, false, T{}});
+					}
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					break;
+			}
+		}
+		std::swap(context.postfix_, output);
+	}
+
+	template <class T>
+	int BasicCalculator<T>::eliminateCommonSubexpressions(CompileContext& context) const {
+		using Node = typename CompileContext::DagNode;
+
+		auto& nodes = context.dagNodes_;
+		auto& children = context.children_;
+		auto& stack = context.indices_;
+		nodes.clear();
+		children.clear();
+		stack.clear();
+
+		auto childrenOf = [&](const Node& node) {
+			return std::span<const int>{children.data() + node.children, static_cast<size_t>(node.parameters)};
+		};
+
+		auto hash = [&](const Node& node) {
+			size_t hash = std::hash<uint64_t>{}(node.value) ^ static_cast<size_t>(node.symbol.type);
+			for (int child : childrenOf(node)) {
+				hash = hash * 31 + std::hash<int>{}(child);
+			}
+			return hash;
+		};
+
+		auto equal = [&](const Node& a, const Node& b) {
+			return a.symbol.type == b.symbol.type && a.value == b.value && std::ranges::equal(childrenOf(a), childrenOf(b));
+		};
+
+		// Open addressing hash table of node indices, -1 is an empty entry.
+		auto& table = context.table_;
+		const size_t tableSize = std::bit_ceil(2 * context.postfix_.size() + 1);
+		table.assign(tableSize, -1);
+
+		// Build the DAG using hash consing, i.e. identical pure sub-expressions are the same node.
+		for (const auto& symbol : context.postfix_) {
+			Node node{symbol};
+			node.children = static_cast<int>(children.size());
+			switch (symbol.type) {
+				case Type::Constant:
+					node.value = toBits(context.constants_[symbol.constant.index]);
+					break;
+				case Type::Variable:
+					node.value = static_cast<uint64_t>(symbol.variable.index);
+					break;
+				case Type::Reduction:
+					node.value = static_cast<uint64_t>(symbol.reduction.operation) << 32 |
+						static_cast<uint64_t>(symbol.reduction.first) << 16 | symbol.reduction.second;
+					break;
+				case Type::Operator:
+					[[fallthrough]];
+				case Type::Function:
+				{
+					const int index = symbol.type == Type::Function ? symbol.function.index : symbol.op.index;
+					const auto& f = functions_[index];
+					node.value = static_cast<uint64_t>(index);
+					node.pure = f.isPure();
+					node.parameters = getArguments(symbol);
+					children.insert(children.end(), stack.end() - node.parameters, stack.end());
+					stack.resize(stack.size() - node.parameters);
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					continue;
+			}
+
+			const int nodeIndex = static_cast<int>(nodes.size());
+			if (!node.pure) {
+				stack.push_back(nodeIndex);
+				nodes.push_back(node);
+				continue;
+			}
+			size_t entry = hash(node) & (tableSize - 1);
+			while (table[entry] >= 0 && !equal(nodes[table[entry]], node)) {
+				entry = (entry + 1) & (tableSize - 1);
+			}
+			if (table[entry] >= 0) {
+				stack.push_back(table[entry]);
+				children.resize(node.children);
+			} else {
+				table[entry] = nodeIndex;
+				stack.push_back(nodeIndex);
+				nodes.push_back(node);
+			}
+		}
+		if (stack.empty()) {
+			return 0;
+		}
+
+		// Count the uses of each node, the final value on the stack is used once.
+		for (int child : children) {
+			++nodes[child].uses;
+		}
+		for (int root : stack) {
+			++nodes[root].uses;
+		}
+
+		// Emit the postfix expression, a node used multiple times is stored in a slot the first time it is excecuted.
+		// Variables and constants are loaded again instead.
+		int slots = 0;
+		auto& output = context.output_;
+		auto& emitStack = context.emitStack_;
+		output.clear();
+		for (int root : stack) {
+			// Node index and the number of children already emitted.
+			emitStack.clear();
+			emitStack.emplace_back(root, 0);
+			while (!emitStack.empty()) {
+				auto [index, emitted] = emitStack.back();
+				auto& node = nodes[index];
+				if (node.slot >= 0) {
+					output.push_back(Load::create(node.slot));
+					emitStack.pop_back();
+				} else if (emitted < node.parameters) {
+					++emitStack.back().second;
+					emitStack.emplace_back(children[node.children + emitted], 0);
+				} else {
+					output.push_back(node.symbol);
+					if (node.uses > 1 && (node.parameters > 0 || node.symbol.type == Type::Reduction)) {
+						node.slot = slots++;
+						output.push_back(Store::create(node.slot));
+					}
+					emitStack.pop_back();
+				}
+			}
+		}
+		std::swap(context.postfix_, output);
+		return slots;
+	}
+
+	template <class T>
+	int BasicCalculator<T>::calculateStackSize(const std::vector<Symbol>& postfix) const {
+		int size = 0;
+		int maxSize = 0;
+		for (const auto& symbol : postfix) {
+			switch (symbol.type) {
+				case Type::Constant:
+					[[fallthrough]];
+				case Type::Variable:
+					[[fallthrough]];
+				case Type::Load:
+					[[fallthrough]];
+				case Type::Reduction:
+					maxSize = std::max(maxSize, ++size);
+					break;
+				case Type::Function:
+					[[fallthrough]];
+				case Type::Operator:
+				{
+					const int parameters = getArguments(symbol);
+					if (size < parameters) {
+						throw CalculatorException{"Expression error"};
+					}
+					size = size - parameters + 1;
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					break;
+			}
+		}
+		return maxSize;
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const Cache& cache) const {
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			stack.resize(cache.stackSize_);
+		}
+		return excecute(cache, stack);
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const Cache& cache, const VariableContext& context) const {
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			stack.resize(cache.stackSize_);
+		}
+		return excecute(cache, context, stack);
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const Cache& cache, const VariableContext& context, std::span<T> stack) const {
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			throw CalculatorException{"Stack is too small for the math expression"};
+		}
+		return excecute(cache, context.values_, stack.data());
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const CacheView& cache) const {
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			stack.resize(cache.stackSize_);
+		}
+		return excecute(cache, variableValues_, stack.data());
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const CacheView& cache, const VariableContext& context) const {
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			stack.resize(cache.stackSize_);
+		}
+		return excecute(cache, context.values_, stack.data());
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(const CacheSet& caches, std::span<T> results) const {
+		excecute(caches, variableValues_, results);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(const CacheSet& caches, const VariableContext& context, std::span<T> results) const {
+		excecute(caches, context.values_, results);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(const CacheSet& caches, std::span<const T> variables, std::span<T> results) const {
+		if (results.size() < static_cast<size_t>(caches.size())) {
+			throw CalculatorException{"Results are fewer than the programs"};
+		}
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(caches.stackSize_)) {
+			stack.resize(caches.stackSize_);
+		}
+		// All programs share the same symbol and constant arrays, only the offsets differ.
+		for (int i = 0; i < caches.size(); ++i) {
+			results[i] = excecute(caches[i], variables, stack.data());
+		}
+	}
+
+	template <class T>
+	BasicVariableContext<T> BasicCalculator<T>::createVariableContext() const {
+		return VariableContext{variableValues_};
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const Cache& cache, std::span<T> stack) const {
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			throw CalculatorException{"Stack is too small for the math expression"};
+		}
+		return excecute(cache, variableValues_, stack.data());
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const Cache& cache, std::span<const T> variables, T* stack) const {
+		if (cache.code_.empty()) {
+			return excecute(CacheView{cache}, variables, stack);
+		}
+		if (variables.size() < static_cast<size_t>(cache.variableCount_)) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		return excecuteBytecode(functions_, cache.code_.data(), cache.constants_.data(), variables.data(), stack, [&](int index) {
+			return reduce(cache.symbols_[index].reduction);
+		});
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const CacheView& cache, std::span<const T> variables, T* stack) const {
+		// Stack pointer to the next free value, the size of the stack is calculated in preCalculate.
+		// The slots are placed at the bottom of the stack.
+		T* top = stack + cache.slots_;
+		const T* constants = cache.constants_.data();
+		for (const auto& symbol : cache.symbols_) {
+			switch (symbol.type) {
+				case Type::Constant:
+					*top++ = constants[symbol.constant.index];
+					break;
+				case Type::Load:
+					*top++ = stack[symbol.load.slot];
+					break;
+				case Type::Store:
+					stack[symbol.store.slot] = top[-1];
+					break;
+				case Type::Variable:
+					if (static_cast<size_t>(symbol.variable.index) >= variables.size()) {
+						throw CalculatorException{"Variable does not exist"};
+					}
+					*top++ = variables[symbol.variable.index];
+					break;
+				case Type::Reduction:
+					*top++ = reduce(symbol.reduction);
+					break;
+				case Type::Operator:
+					top = excecuteOpcode(functions_, symbol.op.opcode, symbol.op.index, 0, top);
+					break;
+				case Type::Function:
+					top = excecuteOpcode(functions_, symbol.function.opcode, symbol.function.index, symbol.function.arguments, top);
+					break;
+				default:
+					// Not part of the excecution.
+					break;
+			}
+		}
+		return top[-1];
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecuteVariables(const Cache& cache, std::span<const T> variables) const {
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < static_cast<size_t>(cache.stackSize_)) {
+			stack.resize(cache.stackSize_);
+		}
+		return excecute(cache, variables, stack.data());
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(const Cache& cache, std::span<const VariableColumn> columns, std::span<T> results) const {
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		const auto variableColumns = resolveColumns(columns, results.size());
+		const auto reductions = reduce(cache);
+		excecuteRows(cache, getKernels<T>(instructionSet_), variableColumns, reductions.data(), 0, results.size(), results.data());
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(ThreadPool& pool, const Cache& cache, std::span<const VariableColumn> columns,
+		std::span<T> results, size_t chunkSize) const {
+
+		const std::span<T> cacheResults[] = {results};
+		excecute(pool, std::span<const Cache>{&cache, 1}, columns, cacheResults, chunkSize);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecute(ThreadPool& pool, std::span<const Cache> caches, std::span<const VariableColumn> columns,
+		std::span<const std::span<T>> results, size_t chunkSize) const {
+
+		if (caches.size() != results.size()) {
+			throw CalculatorException{"Number of caches and results differ"};
+		}
+		if (caches.empty()) {
+			return;
+		}
+		const size_t rows = results.front().size();
+		for (size_t i = 0; i < caches.size(); ++i) {
+			if (caches[i].symbols_.empty()) {
+				throw CalculatorException{"Empty math expression"};
+			}
+			if (results[i].size() != rows) {
+				throw CalculatorException{"All results must have the same number of rows"};
+			}
+		}
+		const auto variableColumns = resolveColumns(columns, rows);
+		const auto& kernels = getKernels<T>(instructionSet_);
+		std::vector<std::vector<T>> reductions;
+		for (const auto& cache : caches) {
+			reductions.push_back(reduce(cache));
+		}
+
+		// A chunk is a whole number of blocks, each task excecutes one chunk of one cache.
+		chunkSize = std::max<size_t>((chunkSize + BatchSize - 1) / BatchSize, 1) * BatchSize;
+		const size_t chunks = (rows + chunkSize - 1) / chunkSize;
+		pool.run(chunks * caches.size(), [&](size_t task) {
+			const size_t index = task / chunks;
+			const size_t begin = (task % chunks) * chunkSize;
+			const size_t end = std::min(begin + chunkSize, rows);
+			excecuteRows(caches[index], kernels, variableColumns, reductions[index].data(), begin, end, results[index].data());
+		});
+	}
+
+	template <class T>
+	std::vector<const T*> BasicCalculator<T>::resolveColumns(std::span<const VariableColumn> columns, size_t rows) const {
+		// Column for each variable index, nullptr if the current variable value is used.
+		std::vector<const T*> variableColumns(variableValues_.size(), nullptr);
+		for (const auto& column : columns) {
+			const Symbol* symbol = symbols_.find(column.name);
+			if (symbol == nullptr || symbol->type != Type::Variable) {
+				throw CalculatorException{concatToString("Column ", column.name, " is not a variable")};
+			}
+			if (column.values.size() < rows) {
+				throw CalculatorException{concatToString("Column ", column.name, " has fewer values than results")};
+			}
+			variableColumns[symbol->variable.index] = column.values.data();
+		}
+		return variableColumns;
+	}
+
+	template <class T>
+	T BasicCalculator<T>::reduce(const Reduction& reduction) const {
+		const auto arrays = static_cast<int>(arrays_.size());
+		if (reduction.first >= arrays || (reduction.operation == ReductionType::Dot && reduction.second >= arrays)) {
+			throw CalculatorException{"Array does not exist"};
+		}
+		const auto& kernels = getKernels<T>(instructionSet_);
+		const auto values = arrays_[reduction.first];
+		switch (reduction.operation) {
+			case ReductionType::Sum:
+				return kernels.sum(values.data(), values.size());
+			case ReductionType::Average:
+				return kernels.sum(values.data(), values.size()) / static_cast<T>(values.size());
+			case ReductionType::Min:
+				return kernels.min(values.data(), values.size());
+			case ReductionType::Max:
+				return kernels.max(values.data(), values.size());
+			case ReductionType::Dot:
+			{
+				const auto other = arrays_[reduction.second];
+				if (other.size() != values.size()) {
+					throw CalculatorException{"Arrays in dot product differ in size"};
+				}
+				return kernels.dot(values.data(), other.data(), values.size());
+			}
+		}
+		return T{};
+	}
+
+	template <class T>
+	std::vector<T> BasicCalculator<T>::reduce(const Cache& cache) const {
+		std::vector<T> reductions;
+		for (const auto& symbol : cache.symbols_) {
+			if (symbol.type == Type::Reduction) {
+				reductions.push_back(reduce(symbol.reduction));
+			}
+		}
+		return reductions;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecuteRows(const Cache& cache, const Kernels& kernels, const std::vector<const T*>& columns,
+		const T* reductions, size_t begin, size_t end, T* results) const {
+
+		// The arguments of an n-ary function in a row are gathered after the stack.
+		size_t arguments = 0;
+		for (const auto& symbol : cache.symbols_) {
+			if (symbol.type == Type::Function) {
+				arguments = std::max<size_t>(arguments, symbol.function.arguments);
+			}
+		}
+		const size_t stackSize = static_cast<size_t>(cache.stackSize_) * BatchSize;
+		ThreadLocalBuffer<std::vector<T>> buffer;
+		auto& stack = buffer.get();
+		if (stack.size() < stackSize + arguments) {
+			stack.resize(stackSize + arguments);
+		}
+		for (size_t row = begin; row < end; row += BatchSize) {
+			const int rows = static_cast<int>(std::min<size_t>(BatchSize, end - row));
+			excecuteBatch(cache, kernels, columns, reductions, row, rows, stack.data(), stack.data() + stackSize, results + row);
+		}
+	}
+
+	template <class T>
+	void BasicCalculator<T>::excecuteBatch(const Cache& cache, const Kernels& kernels, const std::vector<const T*>& columns,
+		const T* reductions, size_t row, int rows, T* stack, T* values, T* results) const {
+
+		// Each stack entry is a block of BatchSize values, one for each row.
+		T* top = stack + cache.slots_ * BatchSize;
+		for (const auto& symbol : cache.symbols_) {
+			switch (symbol.type) {
+				case Type::Constant:
+					std::fill_n(top, rows, cache.constants_[symbol.constant.index]);
+					top += BatchSize;
+					break;
+				case Type::Load:
+					std::copy_n(stack + symbol.load.slot * BatchSize, rows, top);
+					top += BatchSize;
+					break;
+				case Type::Store:
+					std::copy_n(top - BatchSize, rows, stack + symbol.store.slot * BatchSize);
+					break;
+				case Type::Variable:
+				{
+					if (symbol.variable.index < 0 || static_cast<size_t>(symbol.variable.index) >= columns.size()) {
+						throw CalculatorException{"Variable does not exist"};
+					}
+					if (const T* column = columns[symbol.variable.index]) {
+						std::copy_n(column + row, rows, top);
+					} else {
+						std::fill_n(top, rows, variableValues_[symbol.variable.index]);
+					}
+					top += BatchSize;
+					break;
+				}
+				case Type::Reduction:
+					std::fill_n(top, rows, *reductions++);
+					top += BatchSize;
+					break;
+				case Type::Function:
+					[[fallthrough]];
+				case Type::Operator:
+				{
+					int index = symbol.type == Type::Function ? symbol.function.index : symbol.op.index;
+					const auto& f = functions_[index];
+					const int arguments = getArguments(symbol);
+					top -= arguments * BatchSize;
+					const T* b = arguments > 1 ? top + BatchSize : top;
+					switch (symbol.type == Type::Function ? symbol.function.opcode : symbol.op.opcode) {
+						case Opcode::Negate:
+							kernels.negate(top, top, rows);
+							break;
+						case Opcode::Add:
+							kernels.add(top, b, top, rows);
+							break;
+						case Opcode::Subtract:
+							kernels.subtract(top, b, top, rows);
+							break;
+						case Opcode::Multiply:
+							kernels.multiply(top, b, top, rows);
+							break;
+						case Opcode::Divide:
+							kernels.divide(top, b, top, rows);
+							break;
+						case Opcode::Pow:
+							kernels.pow(top, b, top, rows);
+							break;
+						case Opcode::Nary:
+							[[fallthrough]];
+						case Opcode::NaryPointer:
+						{
+							// The arguments of a row are gathered from each block.
+							for (int i = 0; i < rows; ++i) {
+								for (int j = 0; j < arguments; ++j) {
+									values[j] = top[j * BatchSize + i];
+								}
+								top[i] = f.excecute(std::span<const T>{values, static_cast<size_t>(arguments)});
+							}
+							break;
+						}
+						default:
+							for (int i = 0; i < rows; ++i) {
+								top[i] = f.excecute(top[i], b[i]);
+							}
+							break;
+					}
+					top += BatchSize;
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					break;
+			}
+		}
+		std::copy_n(top - BatchSize, rows, results);
+	}
+
+	template <class T>
+	T BasicCalculator<T>::excecute(const std::string& infixNotation) const {
+		if (expressionCache_.getCapacity() == 0) {
+			ThreadLocalBuffer<CompileContext> context;
+			ThreadLocalBuffer<Cache> cache;
+			preCalculate(infixNotation, context.get(), cache.get());
+			return excecute(cache.get());
+		}
+		if (auto cache = expressionCache_.find(infixNotation); cache != nullptr) {
+			return excecute(*cache);
+		}
+		ThreadLocalBuffer<CompileContext> context;
+		Cache cache;
+		preCalculate(infixNotation, context.get(), cache);
+		return excecute(*expressionCache_.insert(infixNotation, std::move(cache)));
+	}
+
+	template <class T>
+	void BasicCalculator<T>::setInstructionSet(InstructionSet instructionSet) {
+		if (!isSupported(instructionSet)) {
+			throw CalculatorException{"Instruction set is not supported by the cpu"};
+		}
+		instructionSet_ = instructionSet;
+	}
+
+	template <class T>
+	InstructionSet BasicCalculator<T>::getInstructionSet() const {
+		return instructionSet_;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::setExpressionCacheCapacity(size_t capacity) {
+		expressionCache_.setCapacity(capacity);
+	}
+
+	template <class T>
+	ExpressionCacheStatistics BasicCalculator<T>::getExpressionCacheStatistics() const {
+		return expressionCache_.getStatistics();
+	}
+
+	template <class T>
+	VariableHandle BasicCalculator<T>::addVariable(const std::string& name, T value) {
+		if (symbols_.contains(name)) {
+			throw CalculatorException{"Variable could not be added, already exist"};
+		}
+		if (variableValues_.size() > static_cast<size_t>(MaxSymbolIndex)) {
+			throw CalculatorException{"Variable could not be added, too many variables"};
+		}
+		const int index = static_cast<int>(variableValues_.size());
+		insertSymbol(name, Variable::create(index));
+		variableValues_.push_back(value);
+		return VariableHandle{index};
+	}
+
+	template <class T>
+	void BasicCalculator<T>::updateVariable(const std::string& name, T value) {
+		const Symbol* symbol = symbols_.find(name);
+		if (symbol == nullptr) {
+			throw CalculatorException{"Variable could not be updated, does not exist"};
+		}
+		if (symbol->type != Type::Variable) {
+			throw CalculatorException{concatToString("Variable ", name, " can not be updated, is not a variable")};
+		}
+		variableValues_[symbol->variable.index] = value;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::setVariables(std::span<const VariableHandle> handles, std::span<const T> values) {
+		if (handles.size() != values.size()) {
+			throw CalculatorException{"Number of handles and values differ"};
+		}
+		for (size_t i = 0; i < handles.size(); ++i) {
+			updateVariable(handles[i], values[i]);
+		}
+	}
+
+	template <class T>
+	void BasicCalculator<T>::setVariables(std::span<const T> values) {
+		if (values.size() != variableValues_.size()) {
+			throw CalculatorException{"Number of values differ from the number of variables"};
+		}
+		std::copy(values.begin(), values.end(), variableValues_.begin());
+	}
+
+	template <class T>
+	VariableHandle BasicCalculator<T>::getVariableHandle(const std::string& name) const {
+		const Symbol* var = symbols_.find(name);
+		if (var == nullptr || var->type != Type::Variable) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		return VariableHandle{var->variable.index};
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addArray(const std::string& name, std::span<const T> values) {
+		if (symbols_.contains(name)) {
+			throw CalculatorException{"Array could not be added, already exist"};
+		}
+		if (arrays_.size() > static_cast<size_t>(MaxArrayIndex)) {
+			throw CalculatorException{"Array could not be added, too many arrays"};
+		}
+		if (arrays_.empty()) {
+			for (const auto& [reductionName, operation] : {std::pair{"sum", ReductionType::Sum}, std::pair{"avg", ReductionType::Average},
+				std::pair{"min", ReductionType::Min}, std::pair{"max", ReductionType::Max}, std::pair{"dot", ReductionType::Dot}}) {
+
+				if (!symbols_.contains(reductionName)) {
+					insertSymbol(reductionName, Reduction::create(operation));
+				}
+			}
+		}
+		insertSymbol(name, Array::create(static_cast<int>(arrays_.size())));
+		arrays_.push_back(values);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::updateArray(const std::string& name, std::span<const T> values) {
+		const Symbol* symbol = symbols_.find(name);
+		if (symbol == nullptr || symbol->type != Type::Array) {
+			throw CalculatorException{"Array could not be updated, does not exist"};
+		}
+		arrays_[symbol->array.index] = values;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasSymbol(const std::string& name) const {
+		return symbols_.contains(name);
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasFunction(const std::string& name) const {
+		const Symbol* symbol = symbols_.find(name);
+		return symbol != nullptr && symbol->type == Type::Function;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasOperator(char token) const {
+		const Symbol* symbol = symbols_.find(std::string_view{&token, 1});
+		return symbol != nullptr && symbol->type == Type::Operator;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasVariable(const std::string& name) const {
+		const Symbol* symbol = symbols_.find(name);
+		return symbol != nullptr && symbol->type == Type::Variable;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasArray(const std::string& name) const {
+		const Symbol* symbol = symbols_.find(name);
+		return symbol != nullptr && symbol->type == Type::Array;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasFunction(const std::string& name, const std::string& infixNotation) const {
+		Cache cache = preCalculate(infixNotation);
+		return hasFunction(name, cache);
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasFunction(const std::string& name, const Cache& cache) const {
+		const Symbol* func = symbols_.find(name);
+		if (func == nullptr || func->type != Type::Function) {
+			return false;
+		}
+		for (const Symbol& symbol : cache.symbols_) {
+			if (symbol.type == Type::Function && symbol.function.index == func->function.index) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasOperator(char token, const std::string& infixNotation) const {
+		return hasOperator(token, preCalculate(infixNotation));
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasOperator(char token, const Cache& cache) const {
+		const Symbol* op = symbols_.find(std::string_view{&token, 1});
+		if (op == nullptr || op->type != Type::Operator) {
+			return false;
+		}
+		for (const Symbol& symbol : cache.symbols_) {
+			if (symbol.type == Type::Operator && symbol.op.token == op->op.token) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasVariable(const std::string& name, const std::string& infixNotation) const {
+		return hasVariable(name, preCalculate(infixNotation));
+	}
+
+	template <class T>
+	bool BasicCalculator<T>::hasVariable(const std::string& name, const Cache& cache) const {
+		const Symbol* var = symbols_.find(name);
+		if (var == nullptr || var->type != Type::Variable) {
+			return false;
+		}
+		for (const auto& symbol : cache.symbols_) {
+			if (symbol.type == Type::Variable && symbol.variable.index == var->variable.index) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <class T>
+	T BasicCalculator<T>::extractVariableValue(const std::string& name) const {
+		const Symbol* var = symbols_.find(name);
+		if (var == nullptr || var->type != Type::Variable) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		return variableValues_[var->variable.index];
+	}
+
+	template <class T>
+	void BasicCalculator<T>::tokenize(std::string_view infixNotation, std::vector<Symbol>& infix, std::vector<T>& constants) const {
+		auto isSpace = [](char key) {
+			return key == ' ' || key == '\t' || key == '\n' || key == '\r' || key == '\f' || key == '\v';
+		};
+		auto isSingleCharSymbol = [&](char key) {
+			return singleCharSymbols_[static_cast<unsigned char>(key)];
+		};
+
+		infix.clear();
+		constants.clear();
+		Symbol lastSymbol = Nothing::create();
+		size_t index = 0;
+		while (index < infixNotation.size()) {
+			if (isSpace(infixNotation[index])) {
+				++index;
+				continue;
+			}
+
+			// A single char symbol or a word ending with a space or a single char symbol.
+			size_t end = index + 1;
+			if (!isSingleCharSymbol(infixNotation[index])) {
+				while (end < infixNotation.size() && !isSpace(infixNotation[end]) && !isSingleCharSymbol(infixNotation[end])) {
+					++end;
+				}
+			}
+			const auto word = infixNotation.substr(index, end - index);
+			index = end;
+
+			Symbol symbol;
+			if (const Symbol* found = symbols_.find(word); found != nullptr) {
+				symbol = *found;
+			} else {
+				// Assume unknown symbol is a value.
+				T value{};
+				const char* last = word.data() + word.size();
+				const bool number = std::isdigit(static_cast<unsigned char>(word[0])) || word[0] == '.';
+				if (auto [ptr, error] = std::from_chars(word.data(), last, value); !number || error != std::errc{} || ptr != last) {
+					throw CalculatorException{concatToString("Unrecognized symbol: ", word)};
+				}
+				constants.push_back(value);
+				symbol = Constant::create(static_cast<int>(constants.size()) - 1);
+			}
+
+			// Plus and minus are unary at the start of an expression and after '(', ',' or another operator.
+			const bool unary = lastSymbol.type == Type::Paranthes && lastSymbol.paranthes.left ||
+				lastSymbol.type == Type::Operator ||
+				lastSymbol.type == Type::Comma ||
+				lastSymbol.type == Type::Nothing;
+			if (symbol.type == Type::Operator && symbol.op.token == Minus && unary) {
+				infix.push_back(unaryMinus_);
+			} else if (symbol.type == Type::Operator && symbol.op.token == Plus && unary) {
+				// Skip symbol.
+			} else {
+				infix.push_back(symbol);
+			}
+			lastSymbol = symbol;
+		}
+	}
+
+	template <class T>
+	void BasicCalculator<T>::insertSymbol(const std::string& name, Symbol symbol) {
+		// A new symbol can change how cached expressions are tokenized.
+		expressionCache_.clear();
+		symbols_.insert(name, symbol);
+		if (name.size() == 1) {
+			singleCharSymbols_.set(static_cast<unsigned char>(name[0]));
+		}
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addOperator(char token, char predence, bool leftAssociative,
+		const std::function<T(T)>& function, bool pure) {
+		
+		insertOperator(token, predence, leftAssociative, ExcecuteFunction{function}, pure);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addOperator(char token, char predence, bool leftAssociative,
+		const std::function<T(T, T)>& function, bool pure) {
+
+		insertOperator(token, predence, leftAssociative, ExcecuteFunction{function}, pure);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::insertOperator(char token, char predence, bool leftAssociative, ExcecuteFunction function, bool pure) {
+		auto str = charToString(token);
+		
+		if (!symbols_.contains(str)) {
+			function.setPure(pure);
+			insertSymbol(str, Operator::create(token, predence, leftAssociative, nextFunctionIndex(), function.getOpcode()));
+			functions_.push_back(function);
+		}
+	}
+
+	template <class T>
+	int BasicCalculator<T>::nextFunctionIndex() const {
+		if (functions_.size() > static_cast<size_t>(MaxSymbolIndex)) {
+			throw CalculatorException{"Too many operators and functions"};
+		}
+		return static_cast<int>(functions_.size());
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addFunction(const std::string& name, const std::function<T(T)>& function, bool pure) {
+		insertFunction(name, ExcecuteFunction{function}, pure);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addFunction(const std::string& name, const std::function<T(T, T)>& function, bool pure) {
+		insertFunction(name, ExcecuteFunction{function}, pure);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::addFunction(const std::string& name, int parameters,
+		const std::function<T(std::span<const T>)>& function, bool pure) {
+
+		insertFunction(name, toNaryFunction(function, parameters), pure);
+	}
+
+	template <class T>
+	void BasicCalculator<T>::insertFunction(const std::string& name, ExcecuteFunction function, bool pure) {
+		if (!symbols_.contains(name)) {
+			function.setPure(pure);
+			insertSymbol(name, Function::create(nextFunctionIndex(), function.getOpcode()));
+			functions_.push_back(function);
+		}
+	}
+
+	template <class T>
+	T BasicCalculator<T>::ExcecuteFunction::excecute(T a, T b) const {
+		switch (opcode_) {
+			case Opcode::Negate:
+				return -a;
+			case Opcode::Add:
+				return a + b;
+			case Opcode::Subtract:
+				return a - b;
+			case Opcode::Multiply:
+				return a * b;
+			case Opcode::Divide:
+				return a / b;
+			case Opcode::Pow:
+				return std::pow(a, b);
+			case Opcode::Unary:
+				return call(a);
+			case Opcode::Binary:
+				return call(a, b);
+			case Opcode::UnaryPointer:
+				return callPointer(a);
+			case Opcode::BinaryPointer:
+				return callPointer(a, b);
+			case Opcode::Nary:
+				[[fallthrough]];
+			case Opcode::NaryPointer:
+				// Excecuted with a span of arguments.
+				break;
+		}
+		return T{};
+	}
+
+	template <class T>
+	T BasicCalculator<T>::ExcecuteFunction::excecute(std::span<const T> arguments) const {
+		switch (opcode_) {
+			case Opcode::Nary:
+				return call(arguments);
+			case Opcode::NaryPointer:
+				return callPointer(arguments);
+			default:
+				return excecute(arguments[0], arguments.size() > 1 ? arguments[1] : T{});
+		}
+	}
+
+	template <class T>
+	std::vector<std::string> BasicCalculator<T>::getVariables() const {
+		std::vector<std::string> variables;
+
+		for (const auto& [name, symbol, hash] : symbols_) {
+			if (symbol.type == Type::Variable) {
+				variables.push_back(name);
+			}
+		}
+		// Sorted by name, the symbol table is in the order the symbols were added.
+		std::sort(variables.begin(), variables.end());
+		return variables;
+	}
+
+	template <class T>
+	std::vector<char> BasicCalculator<T>::getOperators() const {
+		std::vector<char> operators;
+
+		for (const auto& [name, symbol, hash] : symbols_) {
+			if (symbol.type == Type::Operator) {
+				operators.push_back(symbol.op.token);
+			}
+		}
+		std::sort(operators.begin(), operators.end());
+		return operators;
+	}
+
+	template <class T>
+	std::vector<std::string> BasicCalculator<T>::getFunctions() const {
+		std::vector<std::string> functions;
+
+		for (const auto& [name, symbol, hash] : symbols_) {
+			if (symbol.type == Type::Operator) {
+				functions.push_back(name);
+			}
+		}
+		std::sort(functions.begin(), functions.end());
+		return functions;
+	}
+
+	template <class T>
+	void BasicCalculator<T>::shuntingYardAlgorithm(const std::vector<Symbol>& infix, std::vector<Symbol>& operatorStack,
+		std::vector<Symbol>& output) const {
+
+		// A function call is validated against the number of arguments when added to the output.
+		auto pushOutput = [&](const Symbol& symbol) {
+			if (symbol.type == Type::Function && !functions_[symbol.function.index].isValidArguments(symbol.function.arguments)) {
+				throw CalculatorException{"Wrong number of arguments in function call"};
+			}
+			output.push_back(symbol);
+		};
+
+		// A reduction is followed by the arrays inside parantheses, e.g. sum(prices) or dot(w, x). Returns the
+		// reduction of the arrays, a value in the postfix expression.
+		auto parseReduction = [&](size_t& index) {
+			Symbol reduction = infix[index];
+			const int arrays = reduction.reduction.operation == ReductionType::Dot ? 2 : 1;
+			auto isSymbol = [&](size_t position, Type type) {
+				return position < infix.size() && infix[position].type == type;
+			};
+			if (!isSymbol(index + 1, Type::Paranthes) || !infix[index + 1].paranthes.left) {
+				throw CalculatorException{"Missing arrays of reduction"};
+			}
+			for (int i = 0; i < arrays; ++i) {
+				const size_t position = index + 2 + 2 * i;
+				if (!isSymbol(position, Type::Array) || (i + 1 < arrays && !isSymbol(position + 1, Type::Comma))) {
+					throw CalculatorException{"Wrong arguments of reduction, expected arrays"};
+				}
+				(i == 0 ? reduction.reduction.first : reduction.reduction.second) = static_cast<uint16_t>(infix[position].array.index);
+			}
+			index += 2 * arrays + 1;
+			if (!isSymbol(index, Type::Paranthes) || infix[index].paranthes.left) {
+				throw CalculatorException{"Wrong arguments of reduction, expected arrays"};
+			}
+			return reduction;
+		};
+
+		operatorStack.clear();
+		output.clear();
+		for (size_t index = 0; index < infix.size(); ++index) {
+			const Symbol& symbol = infix[index];
+			switch (symbol.type) {
+				case Type::Variable:
+					[[fallthrough]];
+				case Type::Constant:
+					output.push_back(symbol);
+					break;
+				case Type::Function:
+					operatorStack.push_back(symbol);
+					break;
+				case Type::Reduction:
+					output.push_back(parseReduction(index));
+					break;
+				case Type::Array:
+					throw CalculatorException{"Array is only valid as the argument of a reduction"};
+				case Type::Comma:
+					while (operatorStack.size() > 0) {
+						Symbol top = operatorStack.back();
+						// Is a left paranthes?
+						if (top.type == Type::Paranthes && top.paranthes.left) {
+							break;
+						} else { // Not a left paranthes.
+							operatorStack.pop_back();
+							pushOutput(top);
+						}
+					}
+					// Count the arguments of the function called, i.e. the function before the left paranthes.
+					if (operatorStack.size() > 1 && operatorStack[operatorStack.size() - 2].type == Type::Function) {
+						auto& function = operatorStack[operatorStack.size() - 2].function;
+						if (function.arguments == MaxArguments) {
+							throw CalculatorException{"Too many arguments in function call"};
+						}
+						++function.arguments;
+					}
+					break;
+				case Type::Operator:
+					// Empty the operator stack.
+					while (operatorStack.size() > 0 && operatorStack.back().type == Type::Operator &&
+						(((symbol.op.leftAssociative &&
+							symbol.op.predence == operatorStack.back().op.predence)) ||
+							(symbol.op.predence < operatorStack.back().op.predence))) {
+
+						output.push_back(operatorStack.back());
+						operatorStack.pop_back();
+					}
+					operatorStack.push_back(symbol);
+					break;
+				case Type::Paranthes:
+					// Is left paranthes?
+					if (symbol.paranthes.left) {
+						operatorStack.push_back(symbol);
+					} else { // Is right paranthes.
+						if (operatorStack.size() < 1) {
+							throw CalculatorException{"Missing right parameter '(' in expression"};
+						}
+						bool foundLeftParanthes = false;
+
+						while (operatorStack.size() > 0) {
+							auto topSymbol = operatorStack.back();
+							operatorStack.pop_back();
+
+							// Is a left paranthes?
+							if (topSymbol.type == Type::Paranthes && topSymbol.paranthes.left) {
+								foundLeftParanthes = true;
+								break;
+							} else {
+								// 'top' is not a left paranthes.
+								pushOutput(topSymbol);
+							}
+						}
+
+						if (operatorStack.size() > 0 && operatorStack.back().type == Type::Function) {
+							pushOutput(operatorStack.back());
+							operatorStack.pop_back();
+						}
+
+						if (!foundLeftParanthes) {
+							throw CalculatorException{"Error, mismatch of parantheses in expression"};
+						}
+					}
+					break;
+				default:
+					// Not part of the infix notation.
+					break;
+			}
+		}
+
+		if (!operatorStack.empty()) {
+			while (operatorStack.size() > 0) {
+				Symbol top = operatorStack.back();
+				if (top.type == Type::Paranthes) {
+					throw CalculatorException{"Error, mismatch of parantheses in expression"};
+				}
+				operatorStack.pop_back();
+				pushOutput(top);
+			}
+		}
+	}
+
+}
+
+#endif
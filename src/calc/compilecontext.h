@@ -0,0 +1,73 @@
+#ifndef CALCULATOR_CALC_COMPILECONTEXT_H
+#define CALCULATOR_CALC_COMPILECONTEXT_H
+
+#include "symbol.h"
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace calc {
+
+	// Buffers used by Calculator::preCalculate. Reusing the same context means no heap allocation
+	// once the buffers have grown large enough for the expressions compiled.
+	template <class T>
+	class BasicCompileContext {
+	public:
+		template <class> friend class BasicCalculator;
+
+		BasicCompileContext() = default;
+
+	private:
+		// Sub-expression when folding constants.
+		struct FoldNode {
+			std::size_t begin;
+			bool constant;
+			T value;
+		};
+
+		// Node in the DAG when eliminating common sub-expressions.
+		struct DagNode {
+			Symbol symbol;
+			uint64_t value = 0;
+			int parameters = 0;
+			int children = 0; // Index of the first child in children_.
+			int uses = 0;
+			int slot = -1;
+			bool pure = true;
+		};
+
+		// Value on the stack when lowering to bytecode, variables and constants are loaded when needed.
+		enum class OperandType : char {
+			Register,
+			Variable,
+			Constant
+		};
+
+		struct Operand {
+			int index;
+			OperandType type;
+		};
+
+		std::vector<Symbol> infix_;
+		std::vector<Symbol> operators_;
+		std::vector<Symbol> postfix_;
+		std::vector<Symbol> output_;
+		std::vector<T> constants_;
+		std::vector<FoldNode> foldNodes_;
+		std::vector<T> arguments_;
+		std::vector<DagNode> dagNodes_;
+		std::vector<int> children_;
+		std::vector<int> indices_;
+		std::vector<int> table_;
+		std::vector<std::pair<int, int>> emitStack_;
+		std::vector<Operand> operands_;
+	};
+
+	using CompileContext = BasicCompileContext<float>;
+	using DoubleCompileContext = BasicCompileContext<double>;
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef CALCULATOR_CALC_EXPRESSIONCACHE_H
+#define CALCULATOR_CALC_EXPRESSIONCACHE_H
+
+#include "cache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace calc {
+
+	struct ExpressionCacheStatistics {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t size = 0;
+		size_t capacity = 0;
+	};
+
+	// Bounded LRU of compiled expressions keyed by the expression text, safe to use from many threads.
+	template <class T>
+	class BasicExpressionCache {
+	public:
+		using Cache = BasicCache<T>;
+
+		BasicExpressionCache() = default;
+
+		// Only the capacity is copied.
+		BasicExpressionCache(const BasicExpressionCache& other)
+			: capacity_{other.getCapacity()} {
+		}
+
+		BasicExpressionCache& operator=(const BasicExpressionCache& other) {
+			if (this != &other) {
+				setCapacity(other.getCapacity());
+				clear();
+			}
+			return *this;
+		}
+
+		// A capacity of zero disables the cache, the least recently used expressions are removed if above capacity.
+		void setCapacity(size_t capacity) {
+			std::lock_guard lock{mutex_};
+			capacity_ = capacity;
+			evict();
+		}
+
+		// Does not lock, i.e. checking if the cache is disabled costs no synchronization.
+		size_t getCapacity() const {
+			return capacity_.load(std::memory_order_relaxed);
+		}
+
+		// Returns nullptr if not found, counted as a hit or a miss.
+		std::shared_ptr<const Cache> find(std::string_view expression) {
+			std::lock_guard lock{mutex_};
+			auto it = index_.find(expression);
+			if (it == index_.end()) {
+				++misses_;
+				return nullptr;
+			}
+			++hits_;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return it->second->cache;
+		}
+
+		// Insert the compiled expression as the most recently used, returns the cached expression.
+		std::shared_ptr<const Cache> insert(std::string_view expression, Cache cache) {
+			auto compiled = std::make_shared<const Cache>(std::move(cache));
+			std::lock_guard lock{mutex_};
+			if (capacity_ == 0) {
+				return compiled;
+			}
+			if (auto it = index_.find(expression); it != index_.end()) {
+				// Inserted by another thread.
+				entries_.splice(entries_.begin(), entries_, it->second);
+				return it->second->cache;
+			}
+			entries_.push_front(Entry{std::string{expression}, std::move(compiled)});
+			index_.emplace(entries_.front().expression, entries_.begin());
+			evict();
+			return entries_.front().cache;
+		}
+
+		// Remove all expressions, the statistics are kept.
+		void clear() {
+			std::lock_guard lock{mutex_};
+			index_.clear();
+			entries_.clear();
+		}
+
+		ExpressionCacheStatistics getStatistics() const {
+			std::lock_guard lock{mutex_};
+			return {hits_, misses_, entries_.size(), capacity_};
+		}
+
+	private:
+		struct Entry {
+			std::string expression;
+			std::shared_ptr<const Cache> cache; // Shared with threads excecuting the expression.
+		};
+
+		void evict() {
+			while (entries_.size() > capacity_) {
+				index_.erase(entries_.back().expression);
+				entries_.pop_back();
+			}
+		}
+
+		mutable std::mutex mutex_;
+		std::list<Entry> entries_; // Most recently used first.
+		std::unordered_map<std::string_view, typename std::list<Entry>::iterator> index_; // Keys refer to entries_.
+		std::atomic<size_t> capacity_ = 0; // Only changed with the mutex locked.
+		uint64_t hits_ = 0;
+		uint64_t misses_ = 0;
+	};
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include "formulagraph.h"
+#include "bitpattern.h"
+#include "calculatorexception.h"
+
+#include <algorithm>
+
+namespace calc {
+
+	template <class T>
+	BasicFormulaGraph<T>::BasicFormulaGraph(Calculator& calculator)
+		: calculator_{&calculator} {
+	}
+
+	template <class T>
+	VariableHandle BasicFormulaGraph<T>::addFormula(const std::string& name, const std::string& expression) {
+		if (calculator_->hasSymbol(name)) {
+			throw CalculatorException{"Formula could not be added, already exist"};
+		}
+		const VariableHandle handle = calculator_->addVariable(name, T{});
+		formulas_.push_back({expression, handle, Cache{}});
+		formulaIndices_.resize(handle.getIndex() + 1, -1);
+		formulaIndices_[handle.getIndex()] = size() - 1;
+		built_ = false;
+		return handle;
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::build() {
+		const int variables = static_cast<int>(calculator_->variableValues_.size());
+		formulaIndices_.resize(variables, -1);
+
+		// The variables used by each formula, each variable once.
+		std::vector<int> used;
+		std::vector<int> usedOffsets{0};
+		for (auto& formula : formulas_) {
+			formula.cache = calculator_->preCalculate(formula.expression);
+			const size_t begin = used.size();
+			for (const auto& symbol : formula.cache.symbols_) {
+				if (symbol.type == Type::Variable) {
+					used.push_back(symbol.variable.index);
+				}
+			}
+			std::sort(used.begin() + begin, used.end());
+			used.erase(std::unique(used.begin() + begin, used.end()), used.end());
+			usedOffsets.push_back(static_cast<int>(used.size()));
+		}
+
+		// Formulas using each variable.
+		dependentOffsets_.assign(variables + 1, 0);
+		for (int variable : used) {
+			++dependentOffsets_[variable + 1];
+		}
+		for (int i = 0; i < variables; ++i) {
+			dependentOffsets_[i + 1] += dependentOffsets_[i];
+		}
+		dependents_.resize(used.size());
+		auto dependentEnds = dependentOffsets_;
+		for (int i = 0; i < size(); ++i) {
+			for (int j = usedOffsets[i]; j < usedOffsets[i + 1]; ++j) {
+				dependents_[dependentEnds[used[j]]++] = i;
+			}
+		}
+
+		// Topological order by Kahn's algorithm, the formulas used by a formula are excecuted before it.
+		std::vector<int> remaining(size(), 0);
+		std::vector<int> ready;
+		for (int i = 0; i < size(); ++i) {
+			formulas_[i].depth = 0;
+			for (int j = usedOffsets[i]; j < usedOffsets[i + 1]; ++j) {
+				remaining[i] += formulaIndices_[used[j]] >= 0 ? 1 : 0;
+			}
+			if (remaining[i] == 0) {
+				ready.push_back(i);
+			}
+		}
+		int depth = 0;
+		for (size_t next = 0; next < ready.size(); ++next) {
+			const Formula& formula = formulas_[ready[next]];
+			depth = std::max(depth, formula.depth);
+			const int variable = formula.handle.getIndex();
+			for (int i = dependentOffsets_[variable]; i < dependentOffsets_[variable + 1]; ++i) {
+				Formula& dependent = formulas_[dependents_[i]];
+				dependent.depth = std::max(dependent.depth, formula.depth + 1);
+				if (--remaining[dependents_[i]] == 0) {
+					ready.push_back(dependents_[i]);
+				}
+			}
+		}
+		if (ready.size() != formulas_.size()) {
+			throw CalculatorException{"Formulas could not be built, formulas depend on each other in a cycle"};
+		}
+
+		// Everything is recalculated.
+		dirtyFormulas_.assign(formulas_.empty() ? 0 : depth + 1, {});
+		for (auto& formula : formulas_) {
+			formula.dirty = false;
+		}
+		for (int i = 0; i < size(); ++i) {
+			markDirty(i);
+		}
+		firstDirtyDepth_ = 0;
+		built_ = true;
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::updateVariable(VariableHandle handle, T value) {
+		const int index = handle.getIndex();
+		if (index < 0 || static_cast<size_t>(index) >= calculator_->variableValues_.size()) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		if (static_cast<size_t>(index) < formulaIndices_.size() && formulaIndices_[index] >= 0) {
+			throw CalculatorException{"Variable could not be updated, is a formula"};
+		}
+		if (isSameValue(calculator_->variableValues_[index], value)) {
+			return;
+		}
+		calculator_->updateVariable(handle, value);
+
+		// Variables added after the build are not used by the formulas.
+		if (built_ && static_cast<size_t>(index) + 1 < dependentOffsets_.size()) {
+			markDependentsDirty(index);
+		}
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::updateVariable(const std::string& name, T value) {
+		updateVariable(calculator_->getVariableHandle(name), value);
+	}
+
+	template <class T>
+	T BasicFormulaGraph<T>::getValue(VariableHandle handle) const {
+		const int index = handle.getIndex();
+		if (index < 0 || static_cast<size_t>(index) >= calculator_->variableValues_.size()) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		return calculator_->variableValues_[index];
+	}
+
+	template <class T>
+	T BasicFormulaGraph<T>::getValue(const std::string& name) const {
+		return calculator_->extractVariableValue(name);
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::recalculate() {
+		recalculate(nullptr);
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::recalculate(ThreadPool& pool) {
+		recalculate(&pool);
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::recalculate(ThreadPool* pool) {
+		if (!built_) {
+			build();
+		}
+		recalculated_ = 0;
+
+		// Formulas only mark formulas with a larger depth, i.e. each depth is done when reached.
+		for (; firstDirtyDepth_ < dirtyFormulas_.size(); ++firstDirtyDepth_) {
+			auto& dirty = dirtyFormulas_[firstDirtyDepth_];
+			const size_t chunks = (dirty.size() + ChunkSize - 1) / ChunkSize;
+			if (pool != nullptr && chunks > 1) {
+				pool->run(chunks, [&](size_t chunk) {
+					const size_t end = std::min(dirty.size(), (chunk + 1) * ChunkSize);
+					for (size_t i = chunk * ChunkSize; i < end; ++i) {
+						excecute(formulas_[dirty[i]]);
+					}
+				});
+			} else {
+				for (int formula : dirty) {
+					excecute(formulas_[formula]);
+				}
+			}
+			for (int index : dirty) {
+				Formula& formula = formulas_[index];
+				formula.dirty = false;
+				if (formula.changed) {
+					markDependentsDirty(formula.handle.getIndex());
+				}
+			}
+			recalculated_ += static_cast<int>(dirty.size());
+			dirty.clear();
+		}
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::excecute(Formula& formula) {
+		// Formulas with the same depth update different variables and only use variables of smaller depths.
+		const T value = calculator_->excecute(formula.cache);
+		formula.changed = !isSameValue(calculator_->variableValues_[formula.handle.getIndex()], value);
+		calculator_->updateVariable(formula.handle, value);
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::markDirty(int index) {
+		Formula& formula = formulas_[index];
+		if (!formula.dirty) {
+			formula.dirty = true;
+			dirtyFormulas_[formula.depth].push_back(index);
+			firstDirtyDepth_ = std::min(firstDirtyDepth_, static_cast<size_t>(formula.depth));
+		}
+	}
+
+	template <class T>
+	void BasicFormulaGraph<T>::markDependentsDirty(int variable) {
+		for (int i = dependentOffsets_[variable]; i < dependentOffsets_[variable + 1]; ++i) {
+			markDirty(dependents_[i]);
+		}
+	}
+
+	template class BasicFormulaGraph<float>;
+	template class BasicFormulaGraph<double>;
+
+}
@@ -0,0 +1,100 @@
+#ifndef CALCULATOR_CALC_FORMULAGRAPH_H
+#define CALCULATOR_CALC_FORMULAGRAPH_H
+
+#include "calculator.h"
+#include "threadpool.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace calc {
+
+	// Named formulas using variables and other formulas, e.g. margin = price - cost and ratio = margin / price.
+	// Each formula is a variable in the calculator holding its value. Updating a variable marks the formulas using
+	// it as dirty, and recalculate excecutes the dirty formulas in dependency order. A formula whose value is
+	// unchanged does not mark the formulas using it. The calculator must outlive the graph.
+	template <class T>
+	class BasicFormulaGraph {
+	public:
+		using Calculator = BasicCalculator<T>;
+		using Cache = BasicCache<T>;
+
+		// Formulas with the same depth are recalculated in chunks by the pool, if at least two chunks.
+		static constexpr size_t ChunkSize = 256;
+
+		explicit BasicFormulaGraph(Calculator& calculator);
+
+		// Add the name as a variable to the calculator, the expression can use formulas added later.
+		// Returns the handle of the value of the formula.
+		VariableHandle addFormula(const std::string& name, const std::string& expression);
+
+		// Compile the formulas and order them by dependency, all formulas are recalculated by the next recalculate.
+		// Throws CalculatorException if the formulas depend on each other in a cycle. Called by recalculate
+		// if formulas are added.
+		void build();
+
+		// Update a variable used by the formulas, the value of a formula can not be updated.
+		void updateVariable(VariableHandle handle, T value);
+
+		void updateVariable(const std::string& name, T value);
+
+		T getValue(VariableHandle handle) const;
+
+		T getValue(const std::string& name) const;
+
+		// Recalculate the dirty formulas and the formulas depending on changed values.
+		void recalculate();
+
+		// Same as recalculate, formulas with the same depth do not depend on each other and are excecuted by the pool.
+		void recalculate(ThreadPool& pool);
+
+		// Returns the number of formulas.
+		int size() const {
+			return static_cast<int>(formulas_.size());
+		}
+
+		// Returns the number of formulas excecuted by the last recalculate.
+		int getRecalculated() const {
+			return recalculated_;
+		}
+
+	private:
+		struct Formula {
+			std::string expression;
+			VariableHandle handle;
+			Cache cache;
+			int depth = 0; // Longest path from a formula only using variables.
+			bool dirty = false;
+			bool changed = false;
+		};
+
+		void recalculate(ThreadPool* pool);
+
+		void excecute(Formula& formula);
+
+		void markDirty(int formula);
+
+		// Mark the formulas using the variable.
+		void markDependentsDirty(int variable);
+
+		Calculator* calculator_;
+		std::vector<Formula> formulas_;
+		std::vector<int> formulaIndices_; // Formula of each variable, -1 if not a formula.
+		std::vector<int> dependents_; // Formulas using variable i are [dependentOffsets_[i], dependentOffsets_[i + 1]).
+		std::vector<int> dependentOffsets_;
+		std::vector<std::vector<int>> dirtyFormulas_; // Dirty formulas by depth.
+		size_t firstDirtyDepth_ = 0;
+		bool built_ = false;
+		int recalculated_ = 0;
+	};
+
+	using FormulaGraph = BasicFormulaGraph<float>;
+	using DoubleFormulaGraph = BasicFormulaGraph<double>;
+
+	extern template class BasicFormulaGraph<float>;
+	extern template class BasicFormulaGraph<double>;
+
+}
+
+#endif
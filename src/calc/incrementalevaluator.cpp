@@ -0,0 +1,247 @@
+#include "incrementalevaluator.h"
+#include "bitpattern.h"
+#include "calculatorexception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+namespace calc {
+
+	template <class T>
+	BasicIncrementalEvaluator<T>::BasicIncrementalEvaluator(const Calculator& calculator, const CacheView& cache)
+		: calculator_{&calculator}
+		, variables_{calculator.variableValues_} {
+
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+
+		// Build the nodes from the postfix expression, the stack holds the nodes of the values.
+		std::vector<int> stack;
+		std::vector<int> slots(cache.slots_);
+		for (const auto& symbol : cache.symbols_) {
+			int arguments = 0;
+			bool pure = true;
+			switch (symbol.type) {
+				case Type::Store:
+					slots[symbol.store.slot] = stack.back();
+					continue;
+				case Type::Load:
+					stack.push_back(slots[symbol.load.slot]);
+					continue;
+				case Type::Constant:
+					values_.push_back(cache.constants_[symbol.constant.index]);
+					++leaves_;
+					break;
+				case Type::Variable:
+					if (static_cast<size_t>(symbol.variable.index) >= variables_.size()) {
+						throw CalculatorException{"Variable does not exist"};
+					}
+					values_.push_back(variables_[symbol.variable.index]);
+					++leaves_;
+					break;
+				case Type::Reduction:
+					values_.push_back(T{});
+					pure = false;
+					break;
+				case Type::Operator:
+					arguments = calculator.getArguments(symbol);
+					values_.push_back(T{});
+					pure = calculator.functions_[symbol.op.index].isPure();
+					break;
+				case Type::Function:
+					arguments = calculator.getArguments(symbol);
+					values_.push_back(T{});
+					pure = calculator.functions_[symbol.function.index].isPure();
+					break;
+				default:
+					// Not part of the excecution.
+					continue;
+			}
+			const int node = static_cast<int>(nodes_.size());
+			nodes_.push_back({symbol, static_cast<uint32_t>(children_.size()), static_cast<uint32_t>(arguments), 0, 0});
+			children_.insert(children_.end(), stack.end() - arguments, stack.end());
+			stack.resize(stack.size() - arguments);
+			stack.push_back(node);
+			if (static_cast<size_t>(arguments) > arguments_.size()) {
+				arguments_.resize(arguments);
+			}
+			if (!pure) {
+				volatileNodes_.push_back(node);
+			}
+		}
+		root_ = stack.back();
+
+		// Parents of each node, and the nodes of each variable.
+		for (int child : children_) {
+			++nodes_[child].parentCount;
+		}
+		uint32_t offset = 0;
+		for (auto& node : nodes_) {
+			node.parents = offset;
+			offset += node.parentCount;
+			node.parentCount = 0;
+		}
+		parents_.resize(children_.size());
+		variableOffsets_.assign(variables_.size() + 1, 0);
+		for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+			const auto& node = nodes_[i];
+			for (uint32_t j = 0; j < node.childCount; ++j) {
+				auto& child = nodes_[children_[node.children + j]];
+				parents_[child.parents + child.parentCount++] = i;
+			}
+			if (node.symbol.type == Type::Variable) {
+				++variableOffsets_[node.symbol.variable.index + 1];
+			}
+		}
+		for (size_t i = 1; i < variableOffsets_.size(); ++i) {
+			variableOffsets_[i] += variableOffsets_[i - 1];
+		}
+		variableNodes_.resize(variableOffsets_.back());
+		auto variableEnds = variableOffsets_;
+		for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+			if (nodes_[i].symbol.type == Type::Variable) {
+				variableNodes_[variableEnds[nodes_[i].symbol.variable.index]++] = i;
+			}
+		}
+
+		// Everything is calculated by the first excecution.
+		dirty_.assign(nodes_.size(), false);
+		for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+			const Type type = nodes_[i].symbol.type;
+			if (type != Type::Constant && type != Type::Variable) {
+				dirty_[i] = true;
+				dirtyNodes_.push_back(i);
+			}
+		}
+	}
+
+	template <class T>
+	void BasicIncrementalEvaluator<T>::updateVariable(VariableHandle handle, T value) {
+		const int index = handle.getIndex();
+		if (index < 0 || index >= static_cast<int>(variables_.size())) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		if (isSameValue(variables_[index], value)) {
+			return;
+		}
+		variables_[index] = value;
+		for (int i = variableOffsets_[index]; i < variableOffsets_[index + 1]; ++i) {
+			values_[variableNodes_[i]] = value;
+			markParentsDirty(variableNodes_[i]);
+		}
+	}
+
+	template <class T>
+	void BasicIncrementalEvaluator<T>::updateVariable(const std::string& name, T value) {
+		updateVariable(calculator_->getVariableHandle(name), value);
+	}
+
+	template <class T>
+	T BasicIncrementalEvaluator<T>::getValue(VariableHandle handle) const {
+		const int index = handle.getIndex();
+		if (index < 0 || index >= static_cast<int>(variables_.size())) {
+			throw CalculatorException{"Variable does not exist"};
+		}
+		return variables_[index];
+	}
+
+	template <class T>
+	T BasicIncrementalEvaluator<T>::excecute() {
+		for (int node : volatileNodes_) {
+			markDirty(node);
+		}
+
+		// Children are placed before the parents, i.e. the nodes are recalculated in order after their arguments.
+		// Scanning the dirty flags is faster than sorting when many nodes are dirty.
+		if (dirtyNodes_.size() * ScanRatio < nodes_.size()) {
+			std::sort(dirtyNodes_.begin(), dirtyNodes_.end());
+			for (int node : dirtyNodes_) {
+				recalculate(node);
+			}
+		} else if (!dirtyNodes_.empty()) {
+			const int first = *std::min_element(dirtyNodes_.begin(), dirtyNodes_.end());
+			for (int node = first; node < static_cast<int>(nodes_.size()); ++node) {
+				if (dirty_[node]) {
+					recalculate(node);
+				}
+			}
+		}
+		recalculated_ = static_cast<int>(dirtyNodes_.size());
+		dirtyNodes_.clear();
+		return values_[root_];
+	}
+
+	template <class T>
+	void BasicIncrementalEvaluator<T>::recalculate(int index) {
+		const auto& node = nodes_[index];
+		if (node.symbol.type == Type::Reduction) {
+			values_[index] = calculator_->reduce(node.symbol.reduction);
+		} else {
+			T* arguments = arguments_.data();
+			for (uint32_t i = 0; i < node.childCount; ++i) {
+				arguments[i] = values_[children_[node.children + i]];
+			}
+			values_[index] = calculate(node, arguments);
+		}
+		dirty_[index] = false;
+	}
+
+	template <class T>
+	T BasicIncrementalEvaluator<T>::calculate(const Node& node, const T* arguments) const {
+		// Built-in operators are excecuted inline.
+		const Opcode opcode = node.symbol.type == Type::Operator ? node.symbol.op.opcode : node.symbol.function.opcode;
+		switch (opcode) {
+			case Opcode::Negate:
+				return -arguments[0];
+			case Opcode::Add:
+				return arguments[0] + arguments[1];
+			case Opcode::Subtract:
+				return arguments[0] - arguments[1];
+			case Opcode::Multiply:
+				return arguments[0] * arguments[1];
+			case Opcode::Divide:
+				return arguments[0] / arguments[1];
+			case Opcode::Pow:
+				return std::pow(arguments[0], arguments[1]);
+			default:
+				break;
+		}
+		const int function = node.symbol.type == Type::Operator ? node.symbol.op.index : node.symbol.function.index;
+		return calculator_->functions_[function].excecute(std::span<const T>{arguments, node.childCount});
+	}
+
+	template <class T>
+	void BasicIncrementalEvaluator<T>::markDirty(int node) {
+		if (!dirty_[node]) {
+			dirty_[node] = true;
+			dirtyNodes_.push_back(node);
+		}
+		markParentsDirty(node);
+	}
+
+	template <class T>
+	void BasicIncrementalEvaluator<T>::markParentsDirty(int node) {
+		// The dirty nodes after next are used as the queue of nodes whose parents are not yet marked.
+		size_t next = dirtyNodes_.size();
+		while (true) {
+			const auto& current = nodes_[node];
+			for (uint32_t i = 0; i < current.parentCount; ++i) {
+				const int parent = parents_[current.parents + i];
+				if (!dirty_[parent]) {
+					dirty_[parent] = true;
+					dirtyNodes_.push_back(parent);
+				}
+			}
+			if (next == dirtyNodes_.size()) {
+				break;
+			}
+			node = dirtyNodes_[next++];
+		}
+	}
+
+	template class BasicIncrementalEvaluator<float>;
+	template class BasicIncrementalEvaluator<double>;
+
+}
@@ -0,0 +1,91 @@
+#ifndef CALCULATOR_CALC_INCREMENTALEVALUATOR_H
+#define CALCULATOR_CALC_INCREMENTALEVALUATOR_H
+
+#include "calculator.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace calc {
+
+	// Excecutes a program and keeps the value of each sub-expression. Updating a variable marks the sub-expressions
+	// using it as dirty, and the next excecution only recalculates those, i.e. the cost is proportional to the paths
+	// from the changed variables to the result. Impure functions and reductions are recalculated in each excecution.
+	// The variable values are copied from the calculator when created, and the calculator must outlive the evaluator.
+	template <class T>
+	class BasicIncrementalEvaluator {
+	public:
+		using Calculator = BasicCalculator<T>;
+		using CacheView = BasicCacheView<T>;
+
+		BasicIncrementalEvaluator(const Calculator& calculator, const CacheView& cache);
+
+		// The handle must be returned by the calculator. Only marks the sub-expressions as dirty if the value is changed.
+		void updateVariable(VariableHandle handle, T value);
+
+		void updateVariable(const std::string& name, T value);
+
+		T getValue(VariableHandle handle) const;
+
+		// Recalculate the dirty sub-expressions and return the result.
+		T excecute();
+
+		// Returns the number of operators, functions and reductions in the program.
+		int getSize() const {
+			return static_cast<int>(nodes_.size()) - leaves_;
+		}
+
+		// Returns the number of operators, functions and reductions recalculated by the last excecution.
+		int getRecalculated() const {
+			return recalculated_;
+		}
+
+	private:
+		// A symbol in the program, the values of the children are the arguments. Values stored in a slot
+		// by common sub-expression elimination are shared, i.e. a node can have many parents.
+		struct Node {
+			Symbol symbol;
+			uint32_t children; // Offset in children_.
+			uint32_t childCount;
+			uint32_t parents; // Offset in parents_.
+			uint32_t parentCount;
+		};
+
+		// Dirty nodes are sorted if less than one in ScanRatio nodes are dirty, otherwise all nodes are scanned.
+		static constexpr size_t ScanRatio = 16;
+
+		void recalculate(int node);
+
+		T calculate(const Node& node, const T* arguments) const;
+
+		void markDirty(int node);
+
+		void markParentsDirty(int node);
+
+		const Calculator* calculator_;
+		std::vector<Node> nodes_; // In the order of the postfix expression, i.e. children before parents.
+		std::vector<T> values_;
+		std::vector<char> dirty_;
+		std::vector<int> children_;
+		std::vector<int> parents_;
+		std::vector<int> variableNodes_; // Nodes of variable i are [variableOffsets_[i], variableOffsets_[i + 1]).
+		std::vector<int> variableOffsets_;
+		std::vector<int> volatileNodes_; // Recalculated in each excecution.
+		std::vector<int> dirtyNodes_;
+		std::vector<T> variables_;
+		std::vector<T> arguments_; // Sized for the largest number of arguments.
+		int root_ = 0;
+		int leaves_ = 0;
+		int recalculated_ = 0;
+	};
+
+	using IncrementalEvaluator = BasicIncrementalEvaluator<float>;
+	using DoubleIncrementalEvaluator = BasicIncrementalEvaluator<double>;
+
+	extern template class BasicIncrementalEvaluator<float>;
+	extern template class BasicIncrementalEvaluator<double>;
+
+}
+
+#endif
@@ -0,0 +1,361 @@
+#include "jit.h"
+#include "calculatorexception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <span>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define CALCULATOR_JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	float powFunction(float a, float b) {
+		return std::pow(a, b);
+	}
+
+	// Called by the generated code for functions stored as std::function.
+	template <class Function>
+	float callUnary(const Function* function, float a) {
+		return function->call(a);
+	}
+
+	template <class Function>
+	float callBinary(const Function* function, float a, float b) {
+		return function->call(a, b);
+	}
+
+	template <class Function>
+	float callNary(const Function* function, const float* arguments, int count) {
+		return function->call(std::span<const float>{arguments, static_cast<size_t>(count)});
+	}
+
+	template <class Function>
+	float callNaryPointer(const Function* function, const float* arguments, int count) {
+		return function->callPointer(std::span<const float>{arguments, static_cast<size_t>(count)});
+	}
+
+	// Emits x86-64 instructions. The value on top of the evaluation stack is kept in xmm0,
+	// the rest of the stack and the slots are stored in the stack frame.
+	class Assembler {
+	public:
+		const std::vector<uint8_t>& getCode() const {
+			return code_;
+		}
+
+		void prologue(int frameSize) {
+			emit({0x53});					// push rbx
+			emit({0x48, 0x89, 0xFB});		// mov rbx, rdi
+			emit({0x48, 0x81, 0xEC});		// sub rsp, frameSize
+			emit32(frameSize);
+		}
+
+		void epilogue(int frameSize) {
+			emit({0x48, 0x81, 0xC4});		// add rsp, frameSize
+			emit32(frameSize);
+			emit({0x5B, 0xC3});				// pop rbx, ret
+		}
+
+		// movss xmm, [rsp + offset]
+		void loadFrame(int xmm, int offset) {
+			emit({0xF3, 0x0F, 0x10, static_cast<uint8_t>(0x84 | xmm << 3), 0x24});
+			emit32(offset);
+		}
+
+		// movss [rsp + offset], xmm0
+		void storeFrame(int offset) {
+			emit({0xF3, 0x0F, 0x11, 0x84, 0x24});
+			emit32(offset);
+		}
+
+		// movss xmm0, [rbx + offset]
+		void loadVariable(int offset) {
+			emit({0xF3, 0x0F, 0x10, 0x83});
+			emit32(offset);
+		}
+
+		// mov eax, value; movd xmm0, eax
+		void loadConstant(float value) {
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			emit({0xB8});
+			emit32(bits);
+			emit({0x66, 0x0F, 0x6E, 0xC0});
+		}
+
+		// Flip the sign bit of xmm0.
+		void negate() {
+			emit({0x66, 0x0F, 0x7E, 0xC0});	// movd eax, xmm0
+			emit({0x35});					// xor eax, 0x80000000
+			emit32(0x80000000u);
+			emit({0x66, 0x0F, 0x6E, 0xC0});	// movd xmm0, eax
+		}
+
+		// xmm0 = xmm0 op [rsp + offset], for commutative operations (addss 0x58, mulss 0x59).
+		void operateFrame(uint8_t opcode, int offset) {
+			emit({0xF3, 0x0F, opcode, 0x84, 0x24});
+			emit32(offset);
+		}
+
+		// xmm0 = [rsp + offset] op xmm0 (subss 0x5C, divss 0x5E).
+		void operateReversed(uint8_t opcode, int offset) {
+			loadFrame(1, offset);
+			emit({0xF3, 0x0F, opcode, 0xC8});	// op xmm1, xmm0
+			emit({0x0F, 0x28, 0xC1});			// movaps xmm0, xmm1
+		}
+
+		// xmm1 = xmm0, xmm0 = [rsp + offset]
+		void binaryArguments(int offset) {
+			emit({0x0F, 0x28, 0xC8});			// movaps xmm1, xmm0
+			loadFrame(0, offset);
+		}
+
+		// lea rsi, [rsp + offset]; mov edx, count
+		void naryArguments(int offset, int count) {
+			emit({0x48, 0x8D, 0xB4, 0x24});
+			emit32(offset);
+			emit({0xBA});
+			emit32(count);
+		}
+
+		// mov rdi, pointer
+		void loadFirstArgument(const void* pointer) {
+			emit({0x48, 0xBF});
+			emit64(reinterpret_cast<uint64_t>(pointer));
+		}
+
+		// mov rax, function; call rax
+		void call(const void* function) {
+			emit({0x48, 0xB8});
+			emit64(reinterpret_cast<uint64_t>(function));
+			emit({0xFF, 0xD0});
+		}
+
+	private:
+		void emit(std::initializer_list<uint8_t> bytes) {
+			code_.insert(code_.end(), bytes);
+		}
+
+		void emit32(uint32_t value) {
+			for (int i = 0; i < 4; ++i) {
+				code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+			}
+		}
+
+		void emit32(int value) {
+			emit32(static_cast<uint32_t>(value));
+		}
+
+		void emit64(uint64_t value) {
+			for (int i = 0; i < 8; ++i) {
+				code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+			}
+		}
+
+		std::vector<uint8_t> code_;
+	};
+
+	template <class Function>
+	const void* toAddress(Function function) {
+		return reinterpret_cast<const void*>(function);
+	}
+
+}
+
+namespace calc {
+
+	bool JitFunction::isSupported() {
+#ifdef CALCULATOR_JIT_X86_64
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	JitFunction::JitFunction(const Calculator& calculator, const Cache& cache)
+		: calculator_{&calculator}
+		, cache_{cache}
+		, functions_{calculator.functions_} {
+
+		if (cache.symbols_.empty()) {
+			throw CalculatorException{"Empty math expression"};
+		}
+		// Reductions are excecuted by the calculator.
+		const bool reductions = std::any_of(cache.symbols_.begin(), cache.symbols_.end(), [](const Symbol& symbol) {
+			return symbol.type == Type::Reduction;
+		});
+		if (isSupported() && !reductions) {
+			compile();
+		}
+	}
+
+	JitFunction::~JitFunction() {
+		release();
+	}
+
+	JitFunction::JitFunction(JitFunction&& other) noexcept
+		: calculator_{other.calculator_}
+		, cache_{std::move(other.cache_)}
+		, functions_{std::move(other.functions_)}
+		, function_{std::exchange(other.function_, nullptr)}
+		, memory_{std::exchange(other.memory_, nullptr)}
+		, memorySize_{std::exchange(other.memorySize_, 0)}
+		, codeSize_{std::exchange(other.codeSize_, 0)} {
+	}
+
+	JitFunction& JitFunction::operator=(JitFunction&& other) noexcept {
+		if (this != &other) {
+			release();
+			calculator_ = other.calculator_;
+			cache_ = std::move(other.cache_);
+			functions_ = std::move(other.functions_);
+			function_ = std::exchange(other.function_, nullptr);
+			memory_ = std::exchange(other.memory_, nullptr);
+			memorySize_ = std::exchange(other.memorySize_, 0);
+			codeSize_ = std::exchange(other.codeSize_, 0);
+		}
+		return *this;
+	}
+
+	void JitFunction::release() {
+#ifdef CALCULATOR_JIT_X86_64
+		if (memory_ != nullptr) {
+			munmap(memory_, memorySize_);
+		}
+#endif
+		memory_ = nullptr;
+		function_ = nullptr;
+	}
+
+	float JitFunction::excecute(const float* variables) const {
+		const std::span<const float> values{variables, calculator_->variableValues_.size()};
+		return calculator_->excecuteVariables(cache_, values);
+	}
+
+	void JitFunction::compile() {
+#ifdef CALCULATOR_JIT_X86_64
+		Assembler assembler;
+		const int slots = cache_.slots_;
+		// The frame keeps the stack 16 byte aligned at calls, rbx is pushed after the return address.
+		const int frameSize = (cache_.stackSize_ * 4 + 15) / 16 * 16;
+		auto offset = [&](int index) {
+			return 4 * (slots + index);
+		};
+
+		// Number of values on the evaluation stack, the top value is in xmm0.
+		int size = 0;
+		auto push = [&]() {
+			if (size > 0) {
+				assembler.storeFrame(offset(size - 1));
+			}
+			++size;
+		};
+
+		assembler.prologue(frameSize);
+		for (const auto& symbol : cache_.symbols_) {
+			switch (symbol.type) {
+				case Type::Constant:
+					push();
+					assembler.loadConstant(cache_.constants_[symbol.constant.index]);
+					break;
+				case Type::Variable:
+					push();
+					assembler.loadVariable(4 * symbol.variable.index);
+					break;
+				case Type::Load:
+					push();
+					assembler.loadFrame(0, 4 * symbol.load.slot);
+					break;
+				case Type::Store:
+					assembler.storeFrame(4 * symbol.store.slot);
+					break;
+				case Type::Operator:
+					[[fallthrough]];
+				case Type::Function:
+				{
+					const int index = symbol.type == Type::Function ? symbol.function.index : symbol.op.index;
+					const auto& function = functions_[index];
+					const int arguments = calculator_->getArguments(symbol);
+					const int a = offset(size - 2); // First argument of a binary function.
+					switch (function.getOpcode()) {
+						case Opcode::Negate:
+							assembler.negate();
+							break;
+						case Opcode::Add:
+							assembler.operateFrame(0x58, a);
+							break;
+						case Opcode::Multiply:
+							assembler.operateFrame(0x59, a);
+							break;
+						case Opcode::Subtract:
+							assembler.operateReversed(0x5C, a);
+							break;
+						case Opcode::Divide:
+							assembler.operateReversed(0x5E, a);
+							break;
+						case Opcode::Pow:
+							assembler.binaryArguments(a);
+							assembler.call(toAddress(&powFunction));
+							break;
+						case Opcode::UnaryPointer:
+							assembler.call(toAddress(function.getUnaryPointer()));
+							break;
+						case Opcode::BinaryPointer:
+							assembler.binaryArguments(a);
+							assembler.call(toAddress(function.getBinaryPointer()));
+							break;
+						case Opcode::Unary:
+							assembler.loadFirstArgument(&function);
+							assembler.call(toAddress(&callUnary<ExcecuteFunction>));
+							break;
+						case Opcode::Binary:
+							assembler.binaryArguments(a);
+							assembler.loadFirstArgument(&function);
+							assembler.call(toAddress(&callBinary<ExcecuteFunction>));
+							break;
+						case Opcode::Nary:
+							[[fallthrough]];
+						case Opcode::NaryPointer:
+							// The arguments are passed as a pointer into the frame.
+							assembler.storeFrame(offset(size - 1));
+							assembler.naryArguments(offset(size - arguments), arguments);
+							assembler.loadFirstArgument(&function);
+							assembler.call(toAddress(function.getOpcode() == Opcode::Nary
+								? &callNary<ExcecuteFunction> : &callNaryPointer<ExcecuteFunction>));
+							break;
+					}
+					size -= arguments - 1;
+					break;
+				}
+				default:
+					// Not part of the excecution.
+					break;
+			}
+		}
+		assembler.epilogue(frameSize);
+
+		const auto& code = assembler.getCode();
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t memorySize = (code.size() + pageSize - 1) / pageSize * pageSize;
+		void* memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			return; // Excecuted by the calculator instead.
+		}
+		std::memcpy(memory, code.data(), code.size());
+		if (mprotect(memory, memorySize, PROT_READ | PROT_EXEC) != 0) {
+			munmap(memory, memorySize);
+			return;
+		}
+		memory_ = memory;
+		memorySize_ = memorySize;
+		codeSize_ = code.size();
+		function_ = reinterpret_cast<Function>(memory);
+#endif
+	}
+
+}
@@ -0,0 +1,74 @@
+#ifndef CALCULATOR_CALC_JIT_H
+#define CALCULATOR_CALC_JIT_H
+
+#include "calculator.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace calc {
+
+	// A cache compiled to native x86-64 code (System V calling convention). Built-in operators are inlined
+	// and registered functions are called directly. On other platforms, or if the cache uses array reductions,
+	// the cache is excecuted by the calculator.
+	// The variable values are passed in the order the variables were added to the calculator.
+	class JitFunction {
+	public:
+		using Function = float (*)(const float* variables);
+
+		// Returns true if native code can be generated on the current platform.
+		static bool isSupported();
+
+		JitFunction() = default;
+
+		// The calculator must outlive the function, registered functions must not throw.
+		JitFunction(const Calculator& calculator, const Cache& cache);
+
+		~JitFunction();
+
+		JitFunction(const JitFunction&) = delete;
+		JitFunction& operator=(const JitFunction&) = delete;
+
+		JitFunction(JitFunction&& other) noexcept;
+		JitFunction& operator=(JitFunction&& other) noexcept;
+
+		float operator()(const float* variables) const {
+			return function_ != nullptr ? function_(variables) : excecute(variables);
+		}
+
+		// Returns nullptr if no native code was generated.
+		Function getFunction() const {
+			return function_;
+		}
+
+		bool isCompiled() const {
+			return function_ != nullptr;
+		}
+
+		// Returns the size of the generated machine code in bytes.
+		int getCodeSize() const {
+			return static_cast<int>(codeSize_);
+		}
+
+	private:
+		using ExcecuteFunction = Calculator::ExcecuteFunction;
+
+		void compile();
+
+		float excecute(const float* variables) const;
+
+		void release();
+
+		const Calculator* calculator_ = nullptr;
+		Cache cache_;
+		std::vector<ExcecuteFunction> functions_; // Copies, the addresses are part of the generated code.
+		Function function_ = nullptr;
+		void* memory_ = nullptr;
+		size_t memorySize_ = 0;
+		size_t codeSize_ = 0;
+	};
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "kernels.h"
+#include "calculatorexception.h"
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#if defined(CALCULATOR_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace calc {
+
+#ifdef CALCULATOR_SIMD_X86
+	// Defined in kernelssse2.cpp and kernelsavx2.cpp.
+	const Kernels& getSse2Kernels();
+	const Kernels& getAvx2Kernels();
+#endif
+
+}
+
+namespace {
+
+	template <class T>
+	void negate(const T* a, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = -a[i];
+		}
+	}
+
+	template <class T>
+	void add(const T* a, const T* b, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = a[i] + b[i];
+		}
+	}
+
+	template <class T>
+	void subtract(const T* a, const T* b, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = a[i] - b[i];
+		}
+	}
+
+	template <class T>
+	void multiply(const T* a, const T* b, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = a[i] * b[i];
+		}
+	}
+
+	template <class T>
+	void divide(const T* a, const T* b, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = a[i] / b[i];
+		}
+	}
+
+	template <class T>
+	void pow(const T* a, const T* b, T* out, int size) {
+		for (int i = 0; i < size; ++i) {
+			out[i] = std::pow(a[i], b[i]);
+		}
+	}
+
+	// The reductions use independent accumulators, i.e. are not limited by the latency of each operation.
+	template <class T>
+	T sum(const T* a, size_t size) {
+		T partial[4]{};
+		size_t i = 0;
+		for (; i + 4 <= size; i += 4) {
+			for (int j = 0; j < 4; ++j) {
+				partial[j] += a[i + j];
+			}
+		}
+		for (; i < size; ++i) {
+			partial[0] += a[i];
+		}
+		return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+	}
+
+	template <class T>
+	T min(const T* a, size_t size) {
+		T result = std::numeric_limits<T>::infinity();
+		for (size_t i = 0; i < size; ++i) {
+			result = a[i] < result ? a[i] : result;
+		}
+		return result;
+	}
+
+	template <class T>
+	T max(const T* a, size_t size) {
+		T result = -std::numeric_limits<T>::infinity();
+		for (size_t i = 0; i < size; ++i) {
+			result = a[i] > result ? a[i] : result;
+		}
+		return result;
+	}
+
+	template <class T>
+	T dot(const T* a, const T* b, size_t size) {
+		T partial[4]{};
+		size_t i = 0;
+		for (; i + 4 <= size; i += 4) {
+			for (int j = 0; j < 4; ++j) {
+				partial[j] += a[i + j] * b[i + j];
+			}
+		}
+		for (; i < size; ++i) {
+			partial[0] += a[i] * b[i];
+		}
+		return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+	}
+
+	template <class T>
+	constexpr calc::BasicKernels<T> ScalarKernels{negate<T>, add<T>, subtract<T>, multiply<T>, divide<T>, pow<T>,
+		sum<T>, min<T>, max<T>, dot<T>};
+
+#ifdef CALCULATOR_SIMD_X86
+	bool hasAvx2() {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+}
+
+namespace calc {
+
+	bool isSupported(InstructionSet instructionSet) {
+		switch (instructionSet) {
+			case InstructionSet::Scalar:
+				return true;
+#ifdef CALCULATOR_SIMD_X86
+			case InstructionSet::Sse2:
+				return true; // Part of x86-64.
+			case InstructionSet::Avx2:
+			{
+				static const bool avx2 = hasAvx2();
+				return avx2;
+			}
+#endif
+			default:
+				return false;
+		}
+	}
+
+	InstructionSet getSupportedInstructionSet() {
+		for (auto instructionSet : {InstructionSet::Avx2, InstructionSet::Sse2}) {
+			if (isSupported(instructionSet)) {
+				return instructionSet;
+			}
+		}
+		return InstructionSet::Scalar;
+	}
+
+	template <class T>
+	const BasicKernels<T>& getKernels(InstructionSet instructionSet) {
+		if (!isSupported(instructionSet)) {
+			throw CalculatorException{"Instruction set is not supported"};
+		}
+		if constexpr (std::is_same_v<T, float>) {
+			switch (instructionSet) {
+#ifdef CALCULATOR_SIMD_X86
+				case InstructionSet::Sse2:
+					return getSse2Kernels();
+				case InstructionSet::Avx2:
+					return getAvx2Kernels();
+#endif
+				default:
+					break;
+			}
+		}
+		return ScalarKernels<T>;
+	}
+
+	template const Kernels& getKernels<float>(InstructionSet instructionSet);
+	template const DoubleKernels& getKernels<double>(InstructionSet instructionSet);
+
+}
@@ -0,0 +1,47 @@
+#ifndef CALCULATOR_CALC_KERNELS_H
+#define CALCULATOR_CALC_KERNELS_H
+
+#include <cstddef>
+
+namespace calc {
+
+	enum class InstructionSet : char {
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	// Array implementations of the built-in operators, used in batch excecution.
+	// The output array may be the same as one of the input arrays.
+	template <class T>
+	struct BasicKernels {
+		void (*negate)(const T* a, T* out, int size);
+		void (*add)(const T* a, const T* b, T* out, int size);
+		void (*subtract)(const T* a, const T* b, T* out, int size);
+		void (*multiply)(const T* a, const T* b, T* out, int size);
+		void (*divide)(const T* a, const T* b, T* out, int size);
+		void (*pow)(const T* a, const T* b, T* out, int size);
+
+		// Reductions of array variables, the minimum of no values is infinity and the maximum -infinity.
+		T (*sum)(const T* a, size_t size);
+		T (*min)(const T* a, size_t size);
+		T (*max)(const T* a, size_t size);
+		T (*dot)(const T* a, const T* b, size_t size);
+	};
+
+	using Kernels = BasicKernels<float>;
+	using DoubleKernels = BasicKernels<double>;
+
+	// Returns true if the current cpu supports the instruction set.
+	bool isSupported(InstructionSet instructionSet);
+
+	// Returns the fastest instruction set supported by the current cpu.
+	InstructionSet getSupportedInstructionSet();
+
+	// Instantiated for float and double, double uses the scalar kernels for all instruction sets.
+	template <class T>
+	const BasicKernels<T>& getKernels(InstructionSet instructionSet);
+
+}
+
+#endif
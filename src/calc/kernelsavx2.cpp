@@ -0,0 +1,236 @@
+#include "kernels.h"
+
+#ifdef CALCULATOR_SIMD_X86
+
+#include <immintrin.h>
+#include <math.h>
+#include <float.h>
+#include <stddef.h>
+
+namespace {
+
+	constexpr int Lanes = 8;
+
+	__m256 madd(__m256 a, __m256 b, float c) {
+		return _mm256_add_ps(_mm256_mul_ps(a, b), _mm256_set1_ps(c));
+	}
+
+	// Natural logarithm, only valid for positive normal values (Cephes logf).
+	__m256 log(__m256 x) {
+		const __m256 one = _mm256_set1_ps(1.f);
+		__m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(x), 23), _mm256_set1_epi32(126)));
+		__m256 m = _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff))), _mm256_set1_ps(0.5f));
+
+		// Move the mantissa from [0.5, 1) to [sqrt(0.5), sqrt(2)) - 1.
+		__m256 mask = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+		e = _mm256_sub_ps(e, _mm256_and_ps(one, mask));
+		m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(m, mask));
+
+		__m256 z = _mm256_mul_ps(m, m);
+		__m256 y = _mm256_set1_ps(7.0376836292E-2f);
+		y = madd(y, m, -1.1514610310E-1f);
+		y = madd(y, m, 1.1676998740E-1f);
+		y = madd(y, m, -1.2420140846E-1f);
+		y = madd(y, m, 1.4249322787E-1f);
+		y = madd(y, m, -1.6668057665E-1f);
+		y = madd(y, m, 2.0000714765E-1f);
+		y = madd(y, m, -2.4999993993E-1f);
+		y = madd(y, m, 3.3333331174E-1f);
+		y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+		y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(-2.12194440e-4f)));
+		y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+		return _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(e, _mm256_set1_ps(0.693359375f)));
+	}
+
+	// Exponential function, only valid for |x| < 87 (Cephes expf).
+	__m256 exp(__m256 x) {
+		__m256 fx = _mm256_floor_ps(madd(x, _mm256_set1_ps(1.44269504088896341f), 0.5f));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(0.693359375f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(-2.12194440e-4f)));
+
+		__m256 z = _mm256_mul_ps(x, x);
+		__m256 y = _mm256_set1_ps(1.9875691500E-4f);
+		y = madd(y, x, 1.3981999507E-3f);
+		y = madd(y, x, 8.3334519073E-3f);
+		y = madd(y, x, 4.1665795894E-2f);
+		y = madd(y, x, 1.6666665459E-1f);
+		y = madd(y, x, 5.0000001201E-1f);
+		y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, z), x), _mm256_set1_ps(1.f));
+
+		__m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+		return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+	}
+
+	// Computes pow(a, b) as exp(b * log(a)), lanes outside the valid range are computed with powf.
+	__m256 pow(const float* a, const float* b) {
+		__m256 x = _mm256_loadu_ps(a);
+		__m256 t = _mm256_mul_ps(_mm256_loadu_ps(b), log(x));
+		__m256 absT = _mm256_and_ps(t, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+		__m256 valid = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_GE_OQ), _mm256_cmp_ps(x, _mm256_set1_ps(FLT_MAX), _CMP_LE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(absT, _mm256_set1_ps(87.f), _CMP_LT_OQ));
+
+		__m256 result = exp(t);
+		if (int mask = _mm256_movemask_ps(valid); mask != 0xff) {
+			alignas(32) float values[Lanes];
+			_mm256_store_ps(values, result);
+			for (int i = 0; i < Lanes; ++i) {
+				if ((mask & (1 << i)) == 0) {
+					values[i] = powf(a[i], b[i]);
+				}
+			}
+			result = _mm256_load_ps(values);
+		}
+		return result;
+	}
+
+	template <class Operation>
+	void binary(const float* a, const float* b, float* out, int size, Operation operation) {
+		int i = 0;
+		for (; i + 2 * Lanes <= size; i += 2 * Lanes) {
+			__m256 x0 = operation(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+			__m256 x1 = operation(_mm256_loadu_ps(a + i + Lanes), _mm256_loadu_ps(b + i + Lanes));
+			_mm256_storeu_ps(out + i, x0);
+			_mm256_storeu_ps(out + i + Lanes, x1);
+		}
+		for (; i < size; ++i) {
+			out[i] = _mm256_cvtss_f32(operation(_mm256_set1_ps(a[i]), _mm256_set1_ps(b[i])));
+		}
+	}
+
+	void negate(const float* a, float* out, int size) {
+		const __m256 signBit = _mm256_set1_ps(-0.f);
+		binary(a, a, out, size, [&](__m256 x, __m256) {
+			return _mm256_xor_ps(x, signBit);
+		});
+	}
+
+	void add(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m256 x, __m256 y) {
+			return _mm256_add_ps(x, y);
+		});
+	}
+
+	void subtract(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m256 x, __m256 y) {
+			return _mm256_sub_ps(x, y);
+		});
+	}
+
+	void multiply(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m256 x, __m256 y) {
+			return _mm256_mul_ps(x, y);
+		});
+	}
+
+	void divide(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m256 x, __m256 y) {
+			return _mm256_div_ps(x, y);
+		});
+	}
+
+	void pow(const float* a, const float* b, float* out, int size) {
+		int i = 0;
+		for (; i + 2 * Lanes <= size; i += 2 * Lanes) {
+			__m256 x0 = pow(a + i, b + i);
+			__m256 x1 = pow(a + i + Lanes, b + i + Lanes);
+			_mm256_storeu_ps(out + i, x0);
+			_mm256_storeu_ps(out + i + Lanes, x1);
+		}
+		for (; i < size; ++i) {
+			out[i] = powf(a[i], b[i]);
+		}
+	}
+
+	// Reduce size values with four independent accumulators, load returns Lanes values starting at an index and
+	// value a single value, used for the last values if size is not a multiple of Lanes.
+	template <class Load, class Value, class Operation, class Combine>
+	float reduce(size_t size, float initial, Load load, Value value, Operation operation, Combine combine) {
+		const size_t end = size / Lanes * Lanes;
+		__m256 x0 = _mm256_set1_ps(initial);
+		__m256 x1 = x0;
+		__m256 x2 = x0;
+		__m256 x3 = x0;
+		size_t i = 0;
+		for (; i + 4 * Lanes <= end; i += 4 * Lanes) {
+			x0 = operation(x0, load(i));
+			x1 = operation(x1, load(i + Lanes));
+			x2 = operation(x2, load(i + 2 * Lanes));
+			x3 = operation(x3, load(i + 3 * Lanes));
+		}
+		for (; i < end; i += Lanes) {
+			x0 = operation(x0, load(i));
+		}
+		alignas(32) float lanes[Lanes];
+		_mm256_store_ps(lanes, operation(operation(x0, x1), operation(x2, x3)));
+		float result = initial;
+		for (float lane : lanes) {
+			result = combine(result, lane);
+		}
+		for (; i < size; ++i) {
+			result = combine(result, value(i));
+		}
+		return result;
+	}
+
+	float sum(const float* a, size_t size) {
+		return reduce(size, 0.f, [&](size_t i) {
+			return _mm256_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m256 x, __m256 y) {
+			return _mm256_add_ps(x, y);
+		}, [](float x, float y) {
+			return x + y;
+		});
+	}
+
+	float min(const float* a, size_t size) {
+		return reduce(size, INFINITY, [&](size_t i) {
+			return _mm256_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m256 x, __m256 y) {
+			// Returns the second operand if either is NaN, i.e. NaN values are skipped as in the scalar kernel.
+			return _mm256_min_ps(y, x);
+		}, [](float x, float y) {
+			return y < x ? y : x;
+		});
+	}
+
+	float max(const float* a, size_t size) {
+		return reduce(size, -INFINITY, [&](size_t i) {
+			return _mm256_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m256 x, __m256 y) {
+			return _mm256_max_ps(y, x);
+		}, [](float x, float y) {
+			return y > x ? y : x;
+		});
+	}
+
+	float dot(const float* a, const float* b, size_t size) {
+		return reduce(size, 0.f, [&](size_t i) {
+			return _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+		}, [&](size_t i) {
+			return a[i] * b[i];
+		}, [](__m256 x, __m256 y) {
+			return _mm256_add_ps(x, y);
+		}, [](float x, float y) {
+			return x + y;
+		});
+	}
+
+	constexpr calc::Kernels Avx2Kernels{negate, add, subtract, multiply, divide, pow, sum, min, max, dot};
+
+}
+
+namespace calc {
+
+	const Kernels& getAvx2Kernels() {
+		return Avx2Kernels;
+	}
+
+}
+
+#endif
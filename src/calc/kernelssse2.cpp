@@ -0,0 +1,241 @@
+#include "kernels.h"
+
+#ifdef CALCULATOR_SIMD_X86
+
+#include <emmintrin.h>
+#include <math.h>
+#include <float.h>
+#include <stddef.h>
+
+namespace {
+
+	constexpr int Lanes = 4;
+
+	__m128 madd(__m128 a, __m128 b, float c) {
+		return _mm_add_ps(_mm_mul_ps(a, b), _mm_set1_ps(c));
+	}
+
+	__m128 floor(__m128 x) {
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.f)));
+	}
+
+	// Natural logarithm, only valid for positive normal values (Cephes logf).
+	__m128 log(__m128 x) {
+		const __m128 one = _mm_set1_ps(1.f);
+		__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(x), 23), _mm_set1_epi32(126)));
+		__m128 m = _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007fffff))), _mm_set1_ps(0.5f));
+
+		// Move the mantissa from [0.5, 1) to [sqrt(0.5), sqrt(2)) - 1.
+		__m128 mask = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+		e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+		m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(m, mask));
+
+		__m128 z = _mm_mul_ps(m, m);
+		__m128 y = _mm_set1_ps(7.0376836292E-2f);
+		y = madd(y, m, -1.1514610310E-1f);
+		y = madd(y, m, 1.1676998740E-1f);
+		y = madd(y, m, -1.2420140846E-1f);
+		y = madd(y, m, 1.4249322787E-1f);
+		y = madd(y, m, -1.6668057665E-1f);
+		y = madd(y, m, 2.0000714765E-1f);
+		y = madd(y, m, -2.4999993993E-1f);
+		y = madd(y, m, 3.3333331174E-1f);
+		y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+		y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+		y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+	}
+
+	// Exponential function, only valid for |x| < 87 (Cephes expf).
+	__m128 exp(__m128 x) {
+		__m128 fx = floor(madd(x, _mm_set1_ps(1.44269504088896341f), 0.5f));
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 z = _mm_mul_ps(x, x);
+		__m128 y = _mm_set1_ps(1.9875691500E-4f);
+		y = madd(y, x, 1.3981999507E-3f);
+		y = madd(y, x, 8.3334519073E-3f);
+		y = madd(y, x, 4.1665795894E-2f);
+		y = madd(y, x, 1.6666665459E-1f);
+		y = madd(y, x, 5.0000001201E-1f);
+		y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1.f));
+
+		__m128i pow2n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+		return _mm_mul_ps(y, _mm_castsi128_ps(pow2n));
+	}
+
+	// Computes pow(a, b) as exp(b * log(a)), lanes outside the valid range are computed with powf.
+	__m128 pow(const float* a, const float* b) {
+		__m128 x = _mm_loadu_ps(a);
+		__m128 t = _mm_mul_ps(_mm_loadu_ps(b), log(x));
+		__m128 absT = _mm_and_ps(t, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+		__m128 valid = _mm_and_ps(_mm_cmpge_ps(x, _mm_set1_ps(FLT_MIN)), _mm_cmple_ps(x, _mm_set1_ps(FLT_MAX)));
+		valid = _mm_and_ps(valid, _mm_cmplt_ps(absT, _mm_set1_ps(87.f)));
+
+		__m128 result = exp(t);
+		if (int mask = _mm_movemask_ps(valid); mask != 0xf) {
+			alignas(16) float values[Lanes];
+			_mm_store_ps(values, result);
+			for (int i = 0; i < Lanes; ++i) {
+				if ((mask & (1 << i)) == 0) {
+					values[i] = powf(a[i], b[i]);
+				}
+			}
+			result = _mm_load_ps(values);
+		}
+		return result;
+	}
+
+	template <class Operation>
+	void binary(const float* a, const float* b, float* out, int size, Operation operation) {
+		int i = 0;
+		for (; i + 2 * Lanes <= size; i += 2 * Lanes) {
+			__m128 x0 = operation(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+			__m128 x1 = operation(_mm_loadu_ps(a + i + Lanes), _mm_loadu_ps(b + i + Lanes));
+			_mm_storeu_ps(out + i, x0);
+			_mm_storeu_ps(out + i + Lanes, x1);
+		}
+		for (; i < size; ++i) {
+			out[i] = _mm_cvtss_f32(operation(_mm_set_ss(a[i]), _mm_set_ss(b[i])));
+		}
+	}
+
+	void negate(const float* a, float* out, int size) {
+		const __m128 signBit = _mm_set1_ps(-0.f);
+		binary(a, a, out, size, [&](__m128 x, __m128) {
+			return _mm_xor_ps(x, signBit);
+		});
+	}
+
+	void add(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m128 x, __m128 y) {
+			return _mm_add_ps(x, y);
+		});
+	}
+
+	void subtract(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m128 x, __m128 y) {
+			return _mm_sub_ps(x, y);
+		});
+	}
+
+	void multiply(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m128 x, __m128 y) {
+			return _mm_mul_ps(x, y);
+		});
+	}
+
+	void divide(const float* a, const float* b, float* out, int size) {
+		binary(a, b, out, size, [](__m128 x, __m128 y) {
+			return _mm_div_ps(x, y);
+		});
+	}
+
+	void pow(const float* a, const float* b, float* out, int size) {
+		int i = 0;
+		for (; i + 2 * Lanes <= size; i += 2 * Lanes) {
+			__m128 x0 = pow(a + i, b + i);
+			__m128 x1 = pow(a + i + Lanes, b + i + Lanes);
+			_mm_storeu_ps(out + i, x0);
+			_mm_storeu_ps(out + i + Lanes, x1);
+		}
+		for (; i < size; ++i) {
+			out[i] = powf(a[i], b[i]);
+		}
+	}
+
+	// Reduce size values with four independent accumulators, load returns Lanes values starting at an index and
+	// value a single value, used for the last values if size is not a multiple of Lanes.
+	template <class Load, class Value, class Operation, class Combine>
+	float reduce(size_t size, float initial, Load load, Value value, Operation operation, Combine combine) {
+		const size_t end = size / Lanes * Lanes;
+		__m128 x0 = _mm_set1_ps(initial);
+		__m128 x1 = x0;
+		__m128 x2 = x0;
+		__m128 x3 = x0;
+		size_t i = 0;
+		for (; i + 4 * Lanes <= end; i += 4 * Lanes) {
+			x0 = operation(x0, load(i));
+			x1 = operation(x1, load(i + Lanes));
+			x2 = operation(x2, load(i + 2 * Lanes));
+			x3 = operation(x3, load(i + 3 * Lanes));
+		}
+		for (; i < end; i += Lanes) {
+			x0 = operation(x0, load(i));
+		}
+		alignas(16) float lanes[Lanes];
+		_mm_store_ps(lanes, operation(operation(x0, x1), operation(x2, x3)));
+		float result = initial;
+		for (float lane : lanes) {
+			result = combine(result, lane);
+		}
+		for (; i < size; ++i) {
+			result = combine(result, value(i));
+		}
+		return result;
+	}
+
+	float sum(const float* a, size_t size) {
+		return reduce(size, 0.f, [&](size_t i) {
+			return _mm_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m128 x, __m128 y) {
+			return _mm_add_ps(x, y);
+		}, [](float x, float y) {
+			return x + y;
+		});
+	}
+
+	float min(const float* a, size_t size) {
+		return reduce(size, INFINITY, [&](size_t i) {
+			return _mm_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m128 x, __m128 y) {
+			// Returns the second operand if either is NaN, i.e. NaN values are skipped as in the scalar kernel.
+			return _mm_min_ps(y, x);
+		}, [](float x, float y) {
+			return y < x ? y : x;
+		});
+	}
+
+	float max(const float* a, size_t size) {
+		return reduce(size, -INFINITY, [&](size_t i) {
+			return _mm_loadu_ps(a + i);
+		}, [&](size_t i) {
+			return a[i];
+		}, [](__m128 x, __m128 y) {
+			return _mm_max_ps(y, x);
+		}, [](float x, float y) {
+			return y > x ? y : x;
+		});
+	}
+
+	float dot(const float* a, const float* b, size_t size) {
+		return reduce(size, 0.f, [&](size_t i) {
+			return _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+		}, [&](size_t i) {
+			return a[i] * b[i];
+		}, [](__m128 x, __m128 y) {
+			return _mm_add_ps(x, y);
+		}, [](float x, float y) {
+			return x + y;
+		});
+	}
+
+	constexpr calc::Kernels Sse2Kernels{negate, add, subtract, multiply, divide, pow, sum, min, max, dot};
+
+}
+
+namespace calc {
+
+	const Kernels& getSse2Kernels() {
+		return Sse2Kernels;
+	}
+
+}
+
+#endif
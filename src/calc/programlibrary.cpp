@@ -0,0 +1,445 @@
+#include "programlibrary.h"
+#include "calculatorexception.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CALCULATOR_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	constexpr std::array<char, 4> Magic{'C', 'A', 'L', 'C'};
+	constexpr size_t Alignment = 8;
+
+	// File layout: header, table entries, names, program entries and then the symbols and constants of each program.
+	// Each section starts at a multiple of Alignment.
+	struct Header {
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint32_t valueSize;
+		uint32_t symbolSize;
+		uint32_t tableSize;
+		uint32_t programCount;
+		uint64_t tableOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+		uint64_t programsOffset;
+		uint64_t size;
+	};
+
+	// A variable, operator or function used by the programs.
+	struct TableEntry {
+		uint32_t nameOffset;
+		uint32_t nameSize;
+		calc::Symbol symbol;
+		int32_t parameters;
+		uint32_t padding;
+	};
+
+	struct ProgramEntry {
+		uint64_t symbolsOffset;
+		uint64_t constantsOffset;
+		uint32_t symbolCount;
+		uint32_t constantCount;
+		int32_t stackSize;
+		int32_t slots;
+	};
+
+	size_t align(size_t size) {
+		return (size + Alignment - 1) / Alignment * Alignment;
+	}
+
+	void append(std::vector<std::byte>& data, const void* value, size_t size) {
+		const auto bytes = static_cast<const std::byte*>(value);
+		data.insert(data.end(), bytes, bytes + size);
+		data.resize(align(data.size()));
+	}
+
+	template <class Value>
+	Value read(std::span<const std::byte> data, uint64_t offset) {
+		Value value;
+		std::memcpy(&value, data.data() + offset, sizeof(Value));
+		return value;
+	}
+
+	// Returns true if count values of size bytes starting at offset are inside the data and aligned.
+	bool isInside(std::span<const std::byte> data, uint64_t offset, uint64_t count, uint64_t size) {
+		return offset % Alignment == 0 && offset <= data.size() && count * size <= data.size() - offset;
+	}
+
+	bool isSame(calc::Symbol a, calc::Symbol b) {
+		if (a.type != b.type) {
+			return false;
+		}
+		switch (a.type) {
+			case calc::Type::Variable:
+				return a.variable.index == b.variable.index;
+			case calc::Type::Array:
+				return a.array.index == b.array.index;
+			case calc::Type::Function:
+				return a.function.index == b.function.index && a.function.opcode == b.function.opcode;
+			case calc::Type::Operator:
+				return a.op.token == b.op.token && a.op.predence == b.op.predence && a.op.opcode == b.op.opcode &&
+					a.op.index == b.op.index && a.op.leftAssociative == b.op.leftAssociative;
+			default:
+				return false;
+		}
+	}
+
+	void invalid(const char* message) {
+		throw calc::CalculatorException{message};
+	}
+
+}
+
+namespace calc {
+
+	template <class T>
+	std::vector<std::byte> BasicProgramLibrary<T>::serialize(const Calculator& calculator, std::span<const Cache> caches) {
+		// Only the symbols used by the programs are stored.
+		std::vector<bool> usedVariables(calculator.variableValues_.size());
+		std::vector<bool> usedFunctions(calculator.functions_.size());
+		std::vector<bool> usedArrays(calculator.arrays_.size());
+		for (const auto& cache : caches) {
+			if (cache.symbols_.empty()) {
+				invalid("Empty math expression");
+			}
+			for (const auto& symbol : cache.symbols_) {
+				if (symbol.type == Type::Variable) {
+					usedVariables[symbol.variable.index] = true;
+				} else if (symbol.type == Type::Function) {
+					usedFunctions[symbol.function.index] = true;
+				} else if (symbol.type == Type::Operator) {
+					usedFunctions[symbol.op.index] = true;
+				} else if (symbol.type == Type::Reduction) {
+					usedArrays[symbol.reduction.first] = true;
+					if (symbol.reduction.operation == ReductionType::Dot) {
+						usedArrays[symbol.reduction.second] = true;
+					}
+				}
+			}
+		}
+
+		std::vector<TableEntry> table;
+		std::string names;
+		for (const auto& entry : calculator.symbols_) {
+			const Symbol& symbol = entry.symbol;
+			int parameters = 0;
+			if (symbol.type == Type::Variable && usedVariables[symbol.variable.index]) {
+				parameters = 0;
+			} else if (symbol.type == Type::Array && usedArrays[symbol.array.index]) {
+				parameters = 0;
+			} else if (symbol.type == Type::Function && usedFunctions[symbol.function.index]) {
+				parameters = calculator.functions_[symbol.function.index].getParameters();
+			} else if (symbol.type == Type::Operator && usedFunctions[symbol.op.index]) {
+				parameters = calculator.functions_[symbol.op.index].getParameters();
+			} else {
+				continue;
+			}
+			TableEntry tableEntry{};
+			tableEntry.nameOffset = static_cast<uint32_t>(names.size());
+			tableEntry.nameSize = static_cast<uint32_t>(entry.name.size());
+			tableEntry.symbol = symbol;
+			tableEntry.parameters = parameters;
+			table.push_back(tableEntry);
+			names += entry.name;
+		}
+
+		Header header{};
+		header.magic = Magic;
+		header.version = Version;
+		header.valueSize = sizeof(T);
+		header.symbolSize = sizeof(Symbol);
+		header.tableSize = static_cast<uint32_t>(table.size());
+		header.programCount = static_cast<uint32_t>(caches.size());
+		header.tableOffset = align(sizeof(Header));
+		header.namesOffset = header.tableOffset + align(table.size() * sizeof(TableEntry));
+		header.namesSize = names.size();
+		header.programsOffset = header.namesOffset + align(names.size());
+
+		std::vector<ProgramEntry> programs;
+		programs.reserve(caches.size());
+		uint64_t offset = header.programsOffset + align(caches.size() * sizeof(ProgramEntry));
+		for (const auto& cache : caches) {
+			ProgramEntry program{};
+			program.symbolCount = static_cast<uint32_t>(cache.symbols_.size());
+			program.constantCount = static_cast<uint32_t>(cache.constants_.size());
+			program.stackSize = cache.stackSize_;
+			program.slots = cache.slots_;
+			program.symbolsOffset = offset;
+			offset += align(cache.symbols_.size() * sizeof(Symbol));
+			program.constantsOffset = offset;
+			offset += align(cache.constants_.size() * sizeof(T));
+			programs.push_back(program);
+		}
+		header.size = offset;
+
+		std::vector<std::byte> data;
+		data.reserve(header.size);
+		append(data, &header, sizeof(Header));
+		append(data, table.data(), table.size() * sizeof(TableEntry));
+		append(data, names.data(), names.size());
+		append(data, programs.data(), programs.size() * sizeof(ProgramEntry));
+		for (const auto& cache : caches) {
+			append(data, cache.symbols_.data(), cache.symbols_.size() * sizeof(Symbol));
+			append(data, cache.constants_.data(), cache.constants_.size() * sizeof(T));
+		}
+		return data;
+	}
+
+	template <class T>
+	void BasicProgramLibrary<T>::save(const std::string& path, const Calculator& calculator, std::span<const Cache> caches) {
+		const auto data = serialize(calculator, caches);
+		std::ofstream file{path, std::ios::binary | std::ios::trunc};
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file) {
+			throw CalculatorException{"Failed to write program library: " + path};
+		}
+	}
+
+	template <class T>
+	BasicProgramLibrary<T>::BasicProgramLibrary(const Calculator& calculator, const std::string& path) {
+#ifdef CALCULATOR_MMAP
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw CalculatorException{"Failed to open program library: " + path};
+		}
+		struct stat status{};
+		if (fstat(file, &status) != 0 || status.st_size == 0) {
+			close(file);
+			throw CalculatorException{"Failed to read program library: " + path};
+		}
+		mappingSize_ = static_cast<size_t>(status.st_size);
+		void* mapping = mmap(nullptr, mappingSize_, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (mapping == MAP_FAILED) {
+			throw CalculatorException{"Failed to map program library: " + path};
+		}
+		mapping_ = mapping;
+		data_ = {static_cast<const std::byte*>(mapping_), mappingSize_};
+#else
+		std::ifstream file{path, std::ios::binary | std::ios::ate};
+		if (!file) {
+			throw CalculatorException{"Failed to open program library: " + path};
+		}
+		buffer_.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+		if (!file) {
+			throw CalculatorException{"Failed to read program library: " + path};
+		}
+		data_ = buffer_;
+#endif
+		try {
+			load(calculator);
+		} catch (...) {
+			release();
+			throw;
+		}
+	}
+
+	template <class T>
+	BasicProgramLibrary<T>::BasicProgramLibrary(const Calculator& calculator, std::span<const std::byte> data)
+		: data_{data} {
+
+		load(calculator);
+	}
+
+	template <class T>
+	BasicProgramLibrary<T>::~BasicProgramLibrary() {
+		release();
+	}
+
+	template <class T>
+	BasicProgramLibrary<T>::BasicProgramLibrary(BasicProgramLibrary&& other) noexcept
+		: data_{std::exchange(other.data_, {})}
+		, programsOffset_{std::exchange(other.programsOffset_, 0)}
+		, programCount_{std::exchange(other.programCount_, 0)}
+		, mapping_{std::exchange(other.mapping_, nullptr)}
+		, mappingSize_{std::exchange(other.mappingSize_, 0)}
+		, buffer_{std::move(other.buffer_)} {
+	}
+
+	template <class T>
+	BasicProgramLibrary<T>& BasicProgramLibrary<T>::operator=(BasicProgramLibrary&& other) noexcept {
+		if (this != &other) {
+			release();
+			data_ = std::exchange(other.data_, {});
+			programsOffset_ = std::exchange(other.programsOffset_, 0);
+			programCount_ = std::exchange(other.programCount_, 0);
+			mapping_ = std::exchange(other.mapping_, nullptr);
+			mappingSize_ = std::exchange(other.mappingSize_, 0);
+			buffer_ = std::move(other.buffer_);
+		}
+		return *this;
+	}
+
+	template <class T>
+	void BasicProgramLibrary<T>::release() {
+#ifdef CALCULATOR_MMAP
+		if (mapping_ != nullptr) {
+			munmap(mapping_, mappingSize_);
+		}
+#endif
+		mapping_ = nullptr;
+		mappingSize_ = 0;
+		buffer_.clear();
+		data_ = {};
+		programCount_ = 0;
+	}
+
+	template <class T>
+	BasicCacheView<T> BasicProgramLibrary<T>::operator[](int index) const {
+		assert(index >= 0 && index < programCount_);
+		const auto program = read<ProgramEntry>(data_, programsOffset_ + index * sizeof(ProgramEntry));
+		const auto symbols = reinterpret_cast<const Symbol*>(data_.data() + program.symbolsOffset);
+		const auto constants = reinterpret_cast<const T*>(data_.data() + program.constantsOffset);
+		return CacheView{{symbols, program.symbolCount}, {constants, program.constantCount}, program.stackSize, program.slots};
+	}
+
+	template <class T>
+	void BasicProgramLibrary<T>::load(const Calculator& calculator) {
+		if (reinterpret_cast<uintptr_t>(data_.data()) % Alignment != 0) {
+			invalid("Program library data is not aligned");
+		}
+		if (data_.size() < sizeof(Header)) {
+			invalid("Invalid program library");
+		}
+		const auto header = read<Header>(data_, 0);
+		if (header.magic != Magic) {
+			invalid("Invalid program library");
+		}
+		if (header.version != Version) {
+			invalid("Unsupported program library version");
+		}
+		if (header.valueSize != sizeof(T) || header.symbolSize != sizeof(Symbol)) {
+			invalid("Program library compiled for another value type");
+		}
+		if (header.size != data_.size() ||
+			!isInside(data_, header.tableOffset, header.tableSize, sizeof(TableEntry)) ||
+			!isInside(data_, header.namesOffset, header.namesSize, 1) ||
+			!isInside(data_, header.programsOffset, header.programCount, sizeof(ProgramEntry))) {
+
+			invalid("Invalid program library");
+		}
+
+		// The symbols used must mean the same thing in the calculator.
+		std::vector<bool> validVariables(calculator.variableValues_.size());
+		std::vector<bool> validFunctions(calculator.functions_.size());
+		std::vector<bool> validArrays(calculator.arrays_.size());
+		for (uint32_t i = 0; i < header.tableSize; ++i) {
+			const auto entry = read<TableEntry>(data_, header.tableOffset + i * sizeof(TableEntry));
+			if (static_cast<uint64_t>(entry.nameOffset) + entry.nameSize > header.namesSize) {
+				invalid("Invalid program library");
+			}
+			const std::string_view name{reinterpret_cast<const char*>(data_.data() + header.namesOffset + entry.nameOffset), entry.nameSize};
+			const Symbol* symbol = calculator.symbols_.find(name);
+			if (symbol == nullptr || !isSame(*symbol, entry.symbol)) {
+				throw CalculatorException{"Program library symbol does not match the calculator: " + std::string{name}};
+			}
+			if (symbol->type == Type::Variable) {
+				validVariables[symbol->variable.index] = true;
+			} else if (symbol->type == Type::Array) {
+				validArrays[symbol->array.index] = true;
+			} else {
+				const int index = symbol->type == Type::Function ? symbol->function.index : symbol->op.index;
+				if (calculator.functions_[index].getParameters() != entry.parameters) {
+					throw CalculatorException{"Program library symbol does not match the calculator: " + std::string{name}};
+				}
+				validFunctions[index] = true;
+			}
+		}
+
+		// Validate each program, the stack size must be exact since the programs are excecuted without checks.
+		for (uint32_t i = 0; i < header.programCount; ++i) {
+			const auto program = read<ProgramEntry>(data_, header.programsOffset + i * sizeof(ProgramEntry));
+			// Each slot is stored by a symbol, i.e. the number of slots is limited by the number of symbols.
+			if (program.symbolCount == 0 || program.slots < 0 || program.slots > static_cast<int64_t>(program.symbolCount) ||
+				!isInside(data_, program.symbolsOffset, program.symbolCount, sizeof(Symbol)) ||
+				!isInside(data_, program.constantsOffset, program.constantCount, sizeof(T))) {
+
+				invalid("Invalid program library");
+			}
+			const std::span<const Symbol> symbols{reinterpret_cast<const Symbol*>(data_.data() + program.symbolsOffset), program.symbolCount};
+			std::vector<bool> storedSlots(program.slots);
+			int size = 0;
+			int maxSize = 0;
+			for (const auto& symbol : symbols) {
+				int change = 1; // Change of the stack size.
+				bool valid = true;
+				switch (symbol.type) {
+					case Type::Constant:
+						valid = symbol.constant.index >= 0 && static_cast<uint32_t>(symbol.constant.index) < program.constantCount;
+						break;
+					case Type::Variable:
+						valid = symbol.variable.index >= 0 && static_cast<size_t>(symbol.variable.index) < validVariables.size() &&
+							validVariables[symbol.variable.index];
+						break;
+					case Type::Load:
+						// The value of a slot is undefined until stored.
+						valid = symbol.load.slot >= 0 && symbol.load.slot < program.slots && storedSlots[symbol.load.slot];
+						break;
+					case Type::Reduction:
+					{
+						auto isValidArray = [&](int index) {
+							return static_cast<size_t>(index) < validArrays.size() && validArrays[index];
+						};
+						const auto operation = symbol.reduction.operation;
+						valid = operation >= ReductionType::Sum && operation <= ReductionType::Dot && isValidArray(symbol.reduction.first) &&
+							(operation != ReductionType::Dot || isValidArray(symbol.reduction.second));
+						break;
+					}
+					case Type::Store:
+						valid = symbol.store.slot >= 0 && symbol.store.slot < program.slots && size > 0;
+						if (valid) {
+							storedSlots[symbol.store.slot] = true;
+						}
+						change = 0;
+						break;
+					case Type::Operator:
+						[[fallthrough]];
+					case Type::Function:
+					{
+						const int index = symbol.type == Type::Function ? symbol.function.index : static_cast<int>(symbol.op.index);
+						const auto opcode = symbol.type == Type::Function ? symbol.function.opcode : symbol.op.opcode;
+						valid = index >= 0 && static_cast<size_t>(index) < validFunctions.size() && validFunctions[index] &&
+							calculator.functions_[index].getOpcode() == opcode;
+						const int parameters = valid ? calculator.getArguments(symbol) : 0;
+						valid = valid && calculator.functions_[index].isValidArguments(parameters) && size >= parameters;
+						change = 1 - parameters;
+						break;
+					}
+					default:
+						valid = false;
+						break;
+				}
+				if (!valid) {
+					invalid("Invalid program in program library");
+				}
+				size += change;
+				maxSize = std::max(maxSize, size);
+			}
+			if (size != 1 || program.stackSize != program.slots + maxSize) {
+				invalid("Invalid program in program library");
+			}
+		}
+
+		programsOffset_ = header.programsOffset;
+		programCount_ = static_cast<int>(header.programCount);
+	}
+
+	template class BasicProgramLibrary<float>;
+	template class BasicProgramLibrary<double>;
+
+}
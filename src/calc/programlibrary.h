@@ -0,0 +1,76 @@
+#ifndef CALCULATOR_CALC_PROGRAMLIBRARY_H
+#define CALCULATOR_CALC_PROGRAMLIBRARY_H
+
+#include "calculator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace calc {
+
+	// Precompiled programs stored in a versioned binary format, loaded without parsing. The file contains the
+	// names of the variables, operators and functions used, which are validated against the calculator when loaded.
+	// Values are stored in the byte order of the host.
+	template <class T>
+	class BasicProgramLibrary {
+	public:
+		using Calculator = BasicCalculator<T>;
+		using Cache = BasicCache<T>;
+		using CacheView = BasicCacheView<T>;
+
+		static constexpr uint32_t Version = 2;
+
+		// Serialize the caches, compiled by the calculator.
+		static std::vector<std::byte> serialize(const Calculator& calculator, std::span<const Cache> caches);
+
+		static void save(const std::string& path, const Calculator& calculator, std::span<const Cache> caches);
+
+		BasicProgramLibrary() = default;
+
+		// Load the file, memory mapped if supported by the platform. Throws CalculatorException if the file is invalid
+		// or the symbols used do not match the calculator. The programs are excecuted by the calculator.
+		BasicProgramLibrary(const Calculator& calculator, const std::string& path);
+
+		// Use serialized data in place, the data must outlive the library and be aligned to 8 bytes.
+		BasicProgramLibrary(const Calculator& calculator, std::span<const std::byte> data);
+
+		~BasicProgramLibrary();
+
+		BasicProgramLibrary(const BasicProgramLibrary&) = delete;
+		BasicProgramLibrary& operator=(const BasicProgramLibrary&) = delete;
+
+		BasicProgramLibrary(BasicProgramLibrary&& other) noexcept;
+		BasicProgramLibrary& operator=(BasicProgramLibrary&& other) noexcept;
+
+		int size() const {
+			return programCount_;
+		}
+
+		// Returns a view of the program, valid as long as the library.
+		CacheView operator[](int index) const;
+
+	private:
+		void load(const Calculator& calculator);
+
+		void release();
+
+		std::span<const std::byte> data_;
+		size_t programsOffset_ = 0;
+		int programCount_ = 0;
+		void* mapping_ = nullptr;
+		size_t mappingSize_ = 0;
+		std::vector<std::byte> buffer_; // Used if memory mapping is not supported.
+	};
+
+	using ProgramLibrary = BasicProgramLibrary<float>;
+	using DoubleProgramLibrary = BasicProgramLibrary<double>;
+
+	extern template class BasicProgramLibrary<float>;
+	extern template class BasicProgramLibrary<double>;
+
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef CALCULATOR_CALC_STATICEXPRESSION_H
+#define CALCULATOR_CALC_STATICEXPRESSION_H
+
+#include "calculatorexception.h"
+
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace calc {
+
+	// A string literal usable as a template argument.
+	template <std::size_t N>
+	struct FixedString {
+		constexpr FixedString(const char (&str)[N]) {
+			for (std::size_t i = 0; i < N; ++i) {
+				data[i] = str[i];
+			}
+		}
+
+		constexpr std::string_view view() const {
+			return {data, N - 1};
+		}
+
+		char data[N]{};
+	};
+
+	// A math expression parsed during compilation, with the same grammar and operator precedence as the calculator.
+	// Only the default operators are available, the variables are given as arguments in the order they are declared, e.g.
+	// StaticExpression<"2 * x^2 + y", "x", "y">{}(1.f, 2.f)
+	template <class T, FixedString Expression, FixedString... Variables>
+	class BasicStaticExpression {
+	public:
+		static constexpr int VariableCount = sizeof...(Variables);
+
+		template <std::convertible_to<T>... Values>
+		requires (sizeof...(Values) == VariableCount)
+		constexpr T operator()(Values... values) const {
+			const std::array<T, VariableCount> variables{static_cast<T>(values)...};
+			return evaluate<Program.root>(variables);
+		}
+
+		// Returns the number of constants, variables and operators in the expression.
+		static constexpr int getSize() {
+			return Program.size;
+		}
+
+	private:
+		enum class NodeType : char {
+			Constant,
+			Variable,
+			Operator,
+			UnaryMinus,
+			LeftParanthes,
+			RightParanthes
+		};
+
+		struct Node {
+			NodeType type = NodeType::Constant;
+			char token = 0;
+			int predence = 0;
+			bool leftAssociative = true;
+			double value = 0;
+			int index = 0;
+			int left = -1;
+			int right = -1;
+		};
+
+		static constexpr std::size_t Capacity = Expression.view().size() + 1;
+
+		struct ParsedProgram {
+			std::array<Node, Capacity> nodes{};
+			int size = 0;
+			int root = -1;
+		};
+
+		static constexpr bool isSpace(char key) {
+			return key == ' ' || key == '\t' || key == '\n' || key == '\r' || key == '\f' || key == '\v';
+		}
+
+		static constexpr bool isDigit(char key) {
+			return key >= '0' && key <= '9';
+		}
+
+		static constexpr int findVariable(std::string_view word) {
+			constexpr std::array<std::string_view, VariableCount> names{Variables.view()...};
+			for (int i = 0; i < VariableCount; ++i) {
+				if (names[i] == word) {
+					return i;
+				}
+			}
+			return -1;
+		}
+
+		static constexpr bool isSingleCharSymbol(char key) {
+			switch (key) {
+				case '+': case '-': case '*': case '/': case '^': case '(': case ')': case ',':
+					return true;
+				default:
+					return findVariable(std::string_view{&key, 1}) >= 0;
+			}
+		}
+
+		static constexpr Node createOperator(char token) {
+			switch (token) {
+				case '+': case '-':
+					return {NodeType::Operator, token, 2, true};
+				case '*': case '/':
+					return {NodeType::Operator, token, 3, true};
+				default:
+					return {NodeType::Operator, token, 4, false};
+			}
+		}
+
+		// Parses decimal numbers, e.g. "12", "1.5", ".5" and "2e3".
+		static constexpr double parseNumber(std::string_view word) {
+			if (word.empty() || !isDigit(word[0]) && word[0] != '.') {
+				throw CalculatorException{"Unrecognized symbol in static expression"};
+			}
+			double mantissa = 0;
+			int exponent = 0;
+			std::size_t index = 0;
+			bool digits = false;
+			for (; index < word.size() && isDigit(word[index]); ++index) {
+				mantissa = mantissa * 10 + (word[index] - '0');
+				digits = true;
+			}
+			if (index < word.size() && word[index] == '.') {
+				for (++index; index < word.size() && isDigit(word[index]); ++index) {
+					mantissa = mantissa * 10 + (word[index] - '0');
+					--exponent;
+					digits = true;
+				}
+			}
+			if (digits && index < word.size() && (word[index] == 'e' || word[index] == 'E')) {
+				int value = 0;
+				bool exponentDigits = false;
+				for (++index; index < word.size() && isDigit(word[index]); ++index) {
+					value = value * 10 + (word[index] - '0');
+					exponentDigits = true;
+				}
+				if (!exponentDigits) {
+					throw CalculatorException{"Unrecognized symbol in static expression"};
+				}
+				exponent += value;
+			}
+			if (!digits || index != word.size()) {
+				throw CalculatorException{"Unrecognized symbol in static expression"};
+			}
+			double scale = 1;
+			for (int i = 0; i < (exponent < 0 ? -exponent : exponent); ++i) {
+				scale *= 10;
+			}
+			return exponent < 0 ? mantissa / scale : mantissa * scale;
+		}
+
+		static constexpr ParsedProgram parse() {
+			constexpr std::string_view infixNotation = Expression.view();
+
+			// Tokenize.
+			std::array<Node, Capacity> infix{};
+			int infixSize = 0;
+			NodeType lastType = NodeType::LeftParanthes; // Same as the start of the expression.
+			std::size_t index = 0;
+			while (index < infixNotation.size()) {
+				if (isSpace(infixNotation[index])) {
+					++index;
+					continue;
+				}
+				std::size_t end = index + 1;
+				if (!isSingleCharSymbol(infixNotation[index])) {
+					while (end < infixNotation.size() && !isSpace(infixNotation[end]) && !isSingleCharSymbol(infixNotation[end])) {
+						++end;
+					}
+				}
+				const auto word = infixNotation.substr(index, end - index);
+				index = end;
+
+				Node node;
+				if (word == "(") {
+					node.type = NodeType::LeftParanthes;
+				} else if (word == ")") {
+					node.type = NodeType::RightParanthes;
+				} else if (word == ",") {
+					throw CalculatorException{"Functions are not supported in static expressions"};
+				} else if (word.size() == 1 && (word[0] == '+' || word[0] == '-' || word[0] == '*' || word[0] == '/' || word[0] == '^')) {
+					node = createOperator(word[0]);
+				} else if (const int variable = findVariable(word); variable >= 0) {
+					node.type = NodeType::Variable;
+					node.index = variable;
+				} else {
+					node.type = NodeType::Constant;
+					node.value = parseNumber(word);
+				}
+
+				// Plus and minus are unary at the start of an expression and after '(' or another operator.
+				const bool unary = lastType == NodeType::LeftParanthes || lastType == NodeType::Operator || lastType == NodeType::UnaryMinus;
+				if (node.type == NodeType::Operator && node.token == '-' && unary) {
+					infix[infixSize++] = {NodeType::UnaryMinus, '-', 5, false};
+				} else if (!(node.type == NodeType::Operator && node.token == '+' && unary)) {
+					infix[infixSize++] = node;
+				}
+				lastType = node.type;
+			}
+
+			// Shunting-yard algorithm, building the expression tree directly from the output.
+			ParsedProgram program;
+			std::array<Node, Capacity> operators{};
+			int operatorsSize = 0;
+			std::array<int, Capacity> values{};
+			int valuesSize = 0;
+
+			auto output = [&](Node node) {
+				const int parameters = node.type == NodeType::UnaryMinus ? 1 : node.type == NodeType::Operator ? 2 : 0;
+				if (valuesSize < parameters) {
+					throw CalculatorException{"Missing operand in static expression"};
+				}
+				if (parameters == 2) {
+					node.left = values[valuesSize - 2];
+					node.right = values[valuesSize - 1];
+				} else if (parameters == 1) {
+					node.left = values[valuesSize - 1];
+				}
+				valuesSize -= parameters;
+				program.nodes[program.size] = node;
+				values[valuesSize++] = program.size++;
+			};
+
+			for (int i = 0; i < infixSize; ++i) {
+				const Node& node = infix[i];
+				switch (node.type) {
+					case NodeType::Constant:
+						[[fallthrough]];
+					case NodeType::Variable:
+						output(node);
+						break;
+					case NodeType::Operator:
+						[[fallthrough]];
+					case NodeType::UnaryMinus:
+						while (operatorsSize > 0 && operators[operatorsSize - 1].type != NodeType::LeftParanthes &&
+							((node.leftAssociative && node.predence == operators[operatorsSize - 1].predence) ||
+								node.predence < operators[operatorsSize - 1].predence)) {
+
+							output(operators[--operatorsSize]);
+						}
+						operators[operatorsSize++] = node;
+						break;
+					case NodeType::LeftParanthes:
+						operators[operatorsSize++] = node;
+						break;
+					case NodeType::RightParanthes:
+					{
+						bool foundLeftParanthes = false;
+						while (operatorsSize > 0) {
+							const Node top = operators[--operatorsSize];
+							if (top.type == NodeType::LeftParanthes) {
+								foundLeftParanthes = true;
+								break;
+							}
+							output(top);
+						}
+						if (!foundLeftParanthes) {
+							throw CalculatorException{"Error, mismatch of parantheses in static expression"};
+						}
+						break;
+					}
+				}
+			}
+			while (operatorsSize > 0) {
+				const Node top = operators[--operatorsSize];
+				if (top.type == NodeType::LeftParanthes) {
+					throw CalculatorException{"Error, mismatch of parantheses in static expression"};
+				}
+				output(top);
+			}
+			if (valuesSize != 1) {
+				throw CalculatorException{valuesSize == 0 ? "Empty static expression" : "Missing operator in static expression"};
+			}
+			program.root = values[0];
+			return program;
+		}
+
+		static constexpr T pow(T a, T b) {
+			// std::pow is not constexpr, integer exponents are calculated during compilation.
+			if (std::is_constant_evaluated()) {
+				const auto exponent = static_cast<long long>(b);
+				if (static_cast<T>(exponent) == b) {
+					T value = 1;
+					for (long long i = 0; i < (exponent < 0 ? -exponent : exponent); ++i) {
+						value *= a;
+					}
+					return exponent < 0 ? 1 / value : value;
+				}
+			}
+			return std::pow(a, b);
+		}
+
+		template <int Index>
+		static constexpr T evaluate(const std::array<T, VariableCount>& variables) {
+			constexpr Node node = Program.nodes[Index];
+			if constexpr (node.type == NodeType::Constant) {
+				return static_cast<T>(node.value);
+			} else if constexpr (node.type == NodeType::Variable) {
+				return variables[node.index];
+			} else if constexpr (node.type == NodeType::UnaryMinus) {
+				return -evaluate<node.left>(variables);
+			} else {
+				const T a = evaluate<node.left>(variables);
+				const T b = evaluate<node.right>(variables);
+				if constexpr (node.token == '+') {
+					return a + b;
+				} else if constexpr (node.token == '-') {
+					return a - b;
+				} else if constexpr (node.token == '*') {
+					return a * b;
+				} else if constexpr (node.token == '/') {
+					return a / b;
+				} else {
+					return pow(a, b);
+				}
+			}
+		}
+
+		static constexpr ParsedProgram Program = parse();
+	};
+
+	template <FixedString Expression, FixedString... Variables>
+	using StaticExpression = BasicStaticExpression<float, Expression, Variables...>;
+
+	template <FixedString Expression, FixedString... Variables>
+	using DoubleStaticExpression = BasicStaticExpression<double, Expression, Variables...>;
+
+}
+
+#endif
@@ -2,13 +2,14 @@
 
 namespace calc {
 
-	Symbol Operator::create(char token, int8_t predence, bool leftAssociative, char index) {
+	Symbol Operator::create(char token, int8_t predence, bool leftAssociative, int index, Opcode opcode) {
 		Symbol s;
 		s.op.type = Type::Operator;
 		s.op.token = token;
 		s.op.predence = predence;
-		s.op.leftAssociative = leftAssociative;
-		s.op.index = index;
+		s.op.leftAssociative = leftAssociative ? 1 : 0;
+		s.op.index = static_cast<uint32_t>(index);
+		s.op.opcode = opcode;
 		return s;
 	}
 
@@ -19,17 +20,19 @@ namespace calc {
 		return s;
 	}
 
-	Symbol Float::create(float value) {
+	Symbol Constant::create(int index) {
 		Symbol s;
-		s.value.type = Type::Float;
-		s.value.value = value;
+		s.constant.type = Type::Constant;
+		s.constant.index = index;
 		return s;
 	}
 
-	Symbol Function::create(char index) {
+	Symbol Function::create(int index, Opcode opcode) {
 		Symbol s;
 		s.function.type = Type::Function;
 		s.function.index = index;
+		s.function.opcode = opcode;
+		s.function.arguments = 1;
 		return s;
 	}
 
@@ -39,7 +42,7 @@ namespace calc {
 		return s;
 	}
 
-	Symbol Variable::create(char index) {
+	Symbol Variable::create(int index) {
 		Symbol s;
 		s.variable.type = Type::Variable;
 		s.variable.index = index;
@@ -52,4 +55,34 @@ namespace calc {
 		return s;
 	}
 
+	Symbol Load::create(int slot) {
+		Symbol s;
+		s.load.type = Type::Load;
+		s.load.slot = slot;
+		return s;
+	}
+
+	Symbol Store::create(int slot) {
+		Symbol s;
+		s.store.type = Type::Store;
+		s.store.slot = slot;
+		return s;
+	}
+
+	Symbol Array::create(int index) {
+		Symbol s;
+		s.array.type = Type::Array;
+		s.array.index = index;
+		return s;
+	}
+
+	Symbol Reduction::create(ReductionType operation, int first, int second) {
+		Symbol s;
+		s.reduction.type = Type::Reduction;
+		s.reduction.operation = operation;
+		s.reduction.first = static_cast<uint16_t>(first);
+		s.reduction.second = static_cast<uint16_t>(second);
+		return s;
+	}
+
 }
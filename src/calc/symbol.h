@@ -7,24 +7,64 @@ namespace calc {
 
 	enum class Type : char {
 		Operator,
-		Float,
+		Constant,
 		Function,
 		Paranthes,
 		Comma,
 		Variable,
-		Nothing
+		Nothing,
+		Load,
+		Store,
+		Array,
+		Reduction
+	};
+
+	// How an operator or function is excecuted. Built-in operations are excecuted inline,
+	// the rest call the registered function.
+	enum class Opcode : char {
+		Negate,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Pow,
+		Unary,			// std::function<T(T)>
+		Binary,			// std::function<T(T, T)>
+		UnaryPointer,	// T (*)(T)
+		BinaryPointer,	// T (*)(T, T)
+		Nary,			// std::function<T(std::span<const T>)>
+		NaryPointer		// T (*)(std::span<const T>)
+	};
+
+	// Built-in functions reducing arrays to a value.
+	enum class ReductionType : char {
+		Sum,
+		Average,
+		Min,
+		Max,
+		Dot
 	};
 
 	union Symbol;
 
+	// Largest index of a function or variable.
+	constexpr int MaxSymbolIndex = 0x7fffffff;
+
+	// Largest number of arguments in a function call.
+	constexpr int MaxArguments = 0xffff;
+
+	// Largest index of an array.
+	constexpr int MaxArrayIndex = 0xffff;
+
 	struct Operator {
-		static Symbol create(char token, int8_t predence, bool leftAssociative, char index);
+		static Symbol create(char token, int8_t predence, bool leftAssociative, int index, Opcode opcode);
 
 		Type type;
 		char token;
 		int8_t predence;
-		bool leftAssociative;
-		char index;
+		Opcode opcode;
+		uint32_t index : 31;
+		uint32_t leftAssociative : 1;
 	};
 
 	struct Paranthes {
@@ -34,18 +74,22 @@ namespace calc {
 		bool left;
 	};
 
-	struct Float {
-		static Symbol create(float value);
+	// Push the value in the constant pool of the cache onto the stack.
+	struct Constant {
+		static Symbol create(int index);
 
 		Type type;
-		float value;
+		int32_t index;
 	};
 
+	// The number of arguments is resolved when parsing the call, i.e. the commas inside the parantheses.
 	struct Function {
-		static Symbol create(char index);
+		static Symbol create(int index, Opcode opcode);
 
 		Type type;
-		char index;
+		Opcode opcode;
+		uint16_t arguments;
+		int32_t index;
 	};
 
 	struct Comma {
@@ -55,10 +99,10 @@ namespace calc {
 	};
 
 	struct Variable {
-		static Symbol create(char index);
+		static Symbol create(int index);
 
 		Type type;
-		char index;
+		int32_t index;
 	};
 
 	struct Nothing {
@@ -67,17 +111,57 @@ namespace calc {
 		Type type;
 	};
 
+	// Push the value in a slot onto the stack.
+	struct Load {
+		static Symbol create(int slot);
+
+		Type type;
+		int slot;
+	};
+
+	// Copy the top of the stack to a slot, the value is kept on the stack.
+	struct Store {
+		static Symbol create(int slot);
+
+		Type type;
+		int slot;
+	};
+
+	// An array, only valid as the argument of a reduction.
+	struct Array {
+		static Symbol create(int index);
+
+		Type type;
+		int32_t index;
+	};
+
+	// Push the reduction of the arrays onto the stack, e.g. sum(prices) or dot(w, x). The second array is only used by dot.
+	struct Reduction {
+		static Symbol create(ReductionType operation, int first = 0, int second = 0);
+
+		Type type;
+		ReductionType operation;
+		uint16_t first;
+		uint16_t second;
+	};
+
 	union Symbol {
 		Type type;
 		Operator op;
 		Paranthes paranthes;
-		Float value;
+		Constant constant;
 		Function function;
 		Comma comma;
 		Variable variable;
 		Nothing nothing;
+		Load load;
+		Store store;
+		Array array;
+		Reduction reduction;
 	};
 
+	static_assert(sizeof(Symbol) == 8, "Symbol should be small");
+
 }
 
 #endif
@@ -0,0 +1,72 @@
+#include "symboltable.h"
+
+namespace calc {
+
+	namespace {
+
+		constexpr int32_t Empty = -1;
+
+	}
+
+	const Symbol* SymbolTable::find(std::string_view name) const {
+		if (buckets_.empty()) {
+			return nullptr;
+		}
+		const int32_t index = buckets_[findBucket(name, hash(name))];
+		return index == Empty ? nullptr : &entries_[index].symbol;
+	}
+
+	Symbol* SymbolTable::find(std::string_view name) {
+		return const_cast<Symbol*>(static_cast<const SymbolTable&>(*this).find(name));
+	}
+
+	void SymbolTable::insert(std::string_view name, Symbol symbol) {
+		// Keep the load factor at most 1/2, i.e. short probe sequences.
+		if (2 * (entries_.size() + 1) > buckets_.size()) {
+			rehash(buckets_.empty() ? 64 : 2 * buckets_.size());
+		}
+		const size_t nameHash = hash(name);
+		const size_t bucket = findBucket(name, nameHash);
+		if (buckets_[bucket] != Empty) {
+			entries_[buckets_[bucket]].symbol = symbol;
+			return;
+		}
+		buckets_[bucket] = static_cast<int32_t>(entries_.size());
+		entries_.push_back({std::string{name}, symbol, nameHash});
+	}
+
+	size_t SymbolTable::hash(std::string_view name) {
+		// FNV-1a, fast for the short names used in expressions.
+		uint64_t hash = 14695981039346656037ull;
+		for (char key : name) {
+			hash = (hash ^ static_cast<unsigned char>(key)) * 1099511628211ull;
+		}
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+
+	size_t SymbolTable::findBucket(std::string_view name, size_t hash) const {
+		const size_t mask = buckets_.size() - 1;
+		size_t bucket = hash & mask;
+		while (buckets_[bucket] != Empty) {
+			const auto& entry = entries_[buckets_[bucket]];
+			if (entry.hash == hash && entry.name == name) {
+				break;
+			}
+			bucket = (bucket + 1) & mask;
+		}
+		return bucket;
+	}
+
+	void SymbolTable::rehash(size_t bucketCount) {
+		buckets_.assign(bucketCount, Empty);
+		const size_t mask = bucketCount - 1;
+		for (size_t i = 0; i < entries_.size(); ++i) {
+			size_t bucket = entries_[i].hash & mask;
+			while (buckets_[bucket] != Empty) {
+				bucket = (bucket + 1) & mask;
+			}
+			buckets_[bucket] = static_cast<int32_t>(i);
+		}
+	}
+
+}
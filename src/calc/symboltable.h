@@ -0,0 +1,64 @@
+#ifndef CALCULATOR_CALC_SYMBOLTABLE_H
+#define CALCULATOR_CALC_SYMBOLTABLE_H
+
+#include "symbol.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace calc {
+
+	// Flat hash map from name to symbol, looked up by string_view without creating temporary strings.
+	// Uses open addressing with linear probing, the entries are stored contiguously in the order added.
+	class SymbolTable {
+	public:
+		struct Entry {
+			std::string name;
+			Symbol symbol;
+			size_t hash;
+		};
+
+		SymbolTable() = default;
+
+		// Returns nullptr if the name does not exist.
+		const Symbol* find(std::string_view name) const;
+
+		Symbol* find(std::string_view name);
+
+		bool contains(std::string_view name) const {
+			return find(name) != nullptr;
+		}
+
+		// Insert the symbol, or replace the symbol if the name already exists.
+		void insert(std::string_view name, Symbol symbol);
+
+		int size() const {
+			return static_cast<int>(entries_.size());
+		}
+
+		std::vector<Entry>::const_iterator begin() const {
+			return entries_.begin();
+		}
+
+		std::vector<Entry>::const_iterator end() const {
+			return entries_.end();
+		}
+
+	private:
+		static size_t hash(std::string_view name);
+
+		// Returns the bucket containing the name, or the empty bucket where it should be inserted.
+		size_t findBucket(std::string_view name, size_t hash) const;
+
+		void rehash(size_t bucketCount);
+
+		std::vector<Entry> entries_;
+		std::vector<int32_t> buckets_; // Index in entries_, -1 if empty.
+	};
+
+}
+
+#endif
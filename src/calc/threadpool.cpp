@@ -0,0 +1,116 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace calc {
+
+	ThreadPool::ThreadPool(int threads)
+		: ranges_{std::make_unique<Range[]>(std::max(threads, 1))} {
+
+		for (int id = 1; id < threads; ++id) {
+			workers_.emplace_back([this, id]() {
+				workerLoop(id);
+			});
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard lock{mutex_};
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+		std::lock_guard runLock{runMutex_};
+		const size_t threads = static_cast<size_t>(getThreads());
+		for (size_t id = 0; id < threads; ++id) {
+			std::lock_guard lock{ranges_[id].mutex};
+			ranges_[id].begin = count * id / threads;
+			ranges_[id].end = count * (id + 1) / threads;
+		}
+		{
+			std::lock_guard lock{mutex_};
+			task_ = &task;
+			exception_ = nullptr;
+			active_ = static_cast<int>(workers_.size());
+			++generation_;
+		}
+		wake_.notify_all();
+
+		work(0);
+
+		std::unique_lock lock{mutex_};
+		done_.wait(lock, [this]() {
+			return active_ == 0;
+		});
+		task_ = nullptr;
+		if (exception_) {
+			std::rethrow_exception(exception_);
+		}
+	}
+
+	void ThreadPool::workerLoop(int id) {
+		size_t generation = 0;
+		while (true) {
+			{
+				std::unique_lock lock{mutex_};
+				wake_.wait(lock, [&]() {
+					return stop_ || generation != generation_;
+				});
+				if (stop_) {
+					return;
+				}
+				generation = generation_;
+			}
+			work(id);
+			{
+				std::lock_guard lock{mutex_};
+				--active_;
+			}
+			done_.notify_one();
+		}
+	}
+
+	void ThreadPool::work(int id) {
+		size_t index = 0;
+		while (take(id, index) || steal(id, index)) {
+			try {
+				(*task_)(index);
+			} catch (...) {
+				std::lock_guard lock{mutex_};
+				if (!exception_) {
+					exception_ = std::current_exception();
+				}
+			}
+		}
+	}
+
+	bool ThreadPool::take(int id, size_t& index) {
+		auto& range = ranges_[id];
+		std::lock_guard lock{range.mutex};
+		if (range.begin == range.end) {
+			return false;
+		}
+		index = range.begin++;
+		return true;
+	}
+
+	bool ThreadPool::steal(int id, size_t& index) {
+		const int threads = getThreads();
+		for (int i = 1; i < threads; ++i) {
+			auto& range = ranges_[(id + i) % threads];
+			std::lock_guard lock{range.mutex};
+			if (range.begin != range.end) {
+				index = --range.end;
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
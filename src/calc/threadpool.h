@@ -0,0 +1,67 @@
+#ifndef CALCULATOR_CALC_THREADPOOL_H
+#define CALCULATOR_CALC_THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <cstddef>
+
+namespace calc {
+
+	// Work stealing thread pool. Each thread owns a range of task indices and takes tasks from the front,
+	// a thread without tasks steals from the back of another range.
+	class ThreadPool {
+	public:
+		// The calling thread of run is one of the threads, i.e. threads - 1 threads are started.
+		explicit ThreadPool(int threads = static_cast<int>(std::thread::hardware_concurrency()));
+
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		int getThreads() const {
+			return static_cast<int>(workers_.size()) + 1;
+		}
+
+		// Run task(index) for each index in [0, count) and wait for all to finish. The first exception thrown
+		// by a task is rethrown. Must not be called from a task.
+		void run(size_t count, const std::function<void(size_t)>& task);
+
+	private:
+		struct alignas(64) Range {
+			std::mutex mutex;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		void workerLoop(int id);
+
+		// Excecute tasks until there are no tasks left to take or steal.
+		void work(int id);
+
+		bool take(int id, size_t& index);
+
+		bool steal(int id, size_t& index);
+
+		std::vector<std::thread> workers_;
+		std::unique_ptr<Range[]> ranges_;
+
+		std::mutex runMutex_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		const std::function<void(size_t)>* task_ = nullptr;
+		size_t generation_ = 0;
+		int active_ = 0;
+		bool stop_ = false;
+		std::exception_ptr exception_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef CALCULATOR_CALC_VARIABLECONTEXT_H
+#define CALCULATOR_CALC_VARIABLECONTEXT_H
+
+#include <vector>
+#include <span>
+#include <cassert>
+
+namespace calc {
+
+	// Stable reference to a variable in the calculator that added it, updates the value without a name lookup.
+	class VariableHandle {
+	public:
+		template <class> friend class BasicCalculator;
+		template <class> friend class BasicVariableContext;
+
+		VariableHandle() = default;
+
+		int getIndex() const {
+			return index_;
+		}
+
+		bool isValid() const {
+			return index_ >= 0;
+		}
+
+	private:
+		explicit VariableHandle(int index)
+			: index_{index} {
+		}
+
+		int index_ = -1;
+	};
+
+	// Variable values used by Calculator::excecute, separated from the symbol and function tables
+	// in the calculator. One calculator can excecute concurrently on many threads, each thread with
+	// its own context.
+	template <class T>
+	class BasicVariableContext {
+	public:
+		template <class> friend class BasicCalculator;
+
+		BasicVariableContext() = default;
+
+		// The handle must be returned by the calculator that created the context.
+		void updateVariable(VariableHandle handle, T value) noexcept {
+			assert(handle.index_ >= 0 && handle.index_ < static_cast<int>(values_.size()));
+			values_[handle.index_] = value;
+		}
+
+		T getValue(VariableHandle handle) const noexcept {
+			assert(handle.index_ >= 0 && handle.index_ < static_cast<int>(values_.size()));
+			return values_[handle.index_];
+		}
+
+		// Values of all variables, in the order the variables were added.
+		std::span<T> getValues() {
+			return values_;
+		}
+
+		std::span<const T> getValues() const {
+			return values_;
+		}
+
+		int size() const {
+			return static_cast<int>(values_.size());
+		}
+
+	private:
+		explicit BasicVariableContext(const std::vector<T>& values)
+			: values_{values} {
+		}
+
+		std::vector<T> values_;
+	};
+
+	using VariableContext = BasicVariableContext<float>;
+	using DoubleVariableContext = BasicVariableContext<double>;
+
+}
+
+#endif